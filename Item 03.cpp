@@ -1,4 +1,15 @@
+#include <algorithm>
+#include <chrono>
+#include <compare>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
 /**
  * Never treat array polymorphically.
 */
@@ -44,4 +55,473 @@ void printArray(std::ostream& os, const Base array[], std::size_t elements)
 /**
  * The language specification says the result of deleting an array of derived class objects through a base class
  * pointer is undefined.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Contiguous Polymorphic Storage:
+ * The usual way out is to store pointers, e.g. std::vector<std::unique_ptr<Base>>, but then every element is a separate
+ * heap allocation and a scan over the array chases a pointer into a different part of the heap for each element.
+ *
+ * poly_vector<Base> keeps objects of any class derived from Base inline in one contiguous buffer instead. Each object
+ * is preceded by a small header holding a pointer to the operations needed to relocate and destroy it (an inline
+ * vptr for the container's own bookkeeping), and the container records where each object and its Base sub-object
+ * start, so iteration advances by the real size of each element rather than by sizeof(Base). When the buffer grows,
+ * objects are moved into the new buffer one by one; there is never a per-element allocation.
+*/
+class Base
+{
+    public:
+        explicit Base(int value) : value { value } { }
+        virtual ~Base() = default;
+
+        virtual int weight() const { return value; }
+        virtual void print(std::ostream& os) const { os << value; }
+
+    private:
+        int value;
+};
+
+class Derived: public Base
+{
+    public:
+        Derived(int value, int extra) : Base { value }, extra { extra } { }
+
+        int weight() const override { return Base::weight() + extra; }
+        void print(std::ostream& os) const override { Base::print(os); os << '+' << extra; }
+
+    private:
+        int extra;
+};
+
+
+template<class Base>
+class poly_vector
+{
+    private:
+        // Where an element's object and its Base sub-object start, as byte offsets into the buffer
+        struct Slot
+        {
+            std::size_t object;
+            std::size_t base;
+        };
+
+    public:
+        template<class Value, class SlotIterator>
+        class basic_iterator
+        {
+            public:
+                using iterator_category = std::random_access_iterator_tag;
+                using value_type = std::remove_const_t<Value>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = Value*;
+                using reference = Value&;
+
+                basic_iterator() = default;
+                basic_iterator(std::byte* buffer, SlotIterator slot) : buffer { buffer }, slot { slot } { }
+
+                // An iterator is also a const_iterator, as with the standard containers
+                template<class Other>
+                    requires std::is_same_v<const Other, Value> && (!std::is_same_v<Other, Value>)
+                basic_iterator(const basic_iterator<Other, SlotIterator>& rhs)
+                    : buffer { rhs.buffer }, slot { rhs.slot } { }
+
+                reference operator * () const { return *std::launder(reinterpret_cast<pointer>(buffer + slot->base)); }
+                pointer operator -> () const { return &**this; }
+                reference operator [] (difference_type n) const { return *(*this + n); }
+
+                // The slots are a vector, so every step is a step through its iterator
+                basic_iterator& operator ++ () { ++slot; return *this; }
+                basic_iterator operator ++ (int) { basic_iterator old { *this }; ++slot; return old; }
+                basic_iterator& operator -- () { --slot; return *this; }
+                basic_iterator operator -- (int) { basic_iterator old { *this }; --slot; return old; }
+
+                basic_iterator& operator += (difference_type n) { slot += n; return *this; }
+                basic_iterator& operator -= (difference_type n) { slot -= n; return *this; }
+
+                friend basic_iterator operator + (basic_iterator it, difference_type n) { return it += n; }
+                friend basic_iterator operator + (difference_type n, basic_iterator it) { return it += n; }
+                friend basic_iterator operator - (basic_iterator it, difference_type n) { return it -= n; }
+
+                // Friends, so that an iterator converts to a const_iterator on either side
+                friend difference_type operator - (const basic_iterator& lhs, const basic_iterator& rhs)
+                {
+                    return lhs.slot - rhs.slot;
+                }
+
+                // != and the relational operators are rewritten in terms of these two
+                friend bool operator == (const basic_iterator& lhs, const basic_iterator& rhs)
+                {
+                    return lhs.slot == rhs.slot;
+                }
+
+                friend auto operator <=> (const basic_iterator& lhs, const basic_iterator& rhs)
+                {
+                    return lhs.slot <=> rhs.slot;
+                }
+
+            private:
+                template<class, class>
+                friend class basic_iterator;
+
+                std::byte* buffer = nullptr;
+                SlotIterator slot {};
+        };
+
+        using iterator = basic_iterator<Base, typename std::vector<Slot>::const_iterator>;
+        using const_iterator = basic_iterator<const Base, typename std::vector<Slot>::const_iterator>;
+
+        poly_vector() = default;
+        poly_vector(const poly_vector& rhs) = delete;
+        poly_vector& operator = (const poly_vector& rhs) = delete;
+
+        poly_vector(poly_vector&& rhs) noexcept
+            : buffer { std::exchange(rhs.buffer, nullptr) }, capacity { std::exchange(rhs.capacity, 0) },
+              used { std::exchange(rhs.used, 0) }, slots { std::move(rhs.slots) } { }
+
+        poly_vector& operator = (poly_vector&& rhs) noexcept
+        {
+            poly_vector old { std::move(*this) };
+
+            buffer = std::exchange(rhs.buffer, nullptr);
+            capacity = std::exchange(rhs.capacity, 0);
+            used = std::exchange(rhs.used, 0);
+            slots = std::move(rhs.slots);
+
+            return *this;
+        }
+
+        ~poly_vector()
+        {
+            clear();
+            ::operator delete(buffer, std::align_val_t { alignment });
+        }
+
+        // Constructs a Derived in place at the end of the buffer
+        template<class Derived, class... Args>
+        Derived& emplace_back(Args&&... args)
+        {
+            static_assert(std::is_base_of_v<Base, Derived>, "poly_vector only holds classes derived from Base");
+            static_assert(alignof(Derived) <= alignment, "over-aligned types are not supported");
+            static_assert(std::is_nothrow_move_constructible_v<Derived>, "relocation on growth must not throw");
+
+            // The header sits immediately before the object, so aligning the object to at least alignof(Header)
+            // keeps the header aligned too
+            const std::size_t object = roundUp(used + sizeof(Header), std::max(alignof(Derived), alignof(Header)));
+            const std::size_t header = object - sizeof(Header);
+            const std::size_t end = roundUp(object + sizeof(Derived), alignof(Header));
+
+            // Make room for the slot first, so nothing after construction can throw
+            if (slots.size() == slots.capacity())
+            {
+                slots.reserve(std::max<std::size_t>(8, slots.size() * 2));
+            }
+
+            reserveBytes(end);
+
+            Derived* created = ::new (buffer + object) Derived(std::forward<Args>(args)...);
+            ::new (buffer + header) Header { &operationsFor<Derived> };
+
+            const Base* base = created;
+            slots.push_back({ object, static_cast<std::size_t>(reinterpret_cast<const std::byte*>(base) - buffer) });
+            used = end;
+
+            return *created;
+        }
+
+        void clear() noexcept
+        {
+            for (const Slot& slot : slots)
+            {
+                headerOf(slot).operations->destroy(buffer + slot.object);
+            }
+
+            slots.clear();
+            used = 0;
+        }
+
+        std::size_t size() const { return slots.size(); }
+        bool empty() const { return slots.empty(); }
+
+        Base& operator [] (std::size_t index) { return *std::launder(reinterpret_cast<Base*>(buffer + slots[index].base)); }
+
+        const Base& operator [] (std::size_t index) const
+        {
+            return *std::launder(reinterpret_cast<const Base*>(buffer + slots[index].base));
+        }
+
+        iterator begin() { return { buffer, slots.cbegin() }; }
+        iterator end() { return { buffer, slots.cend() }; }
+        const_iterator begin() const { return { buffer, slots.cbegin() }; }
+        const_iterator end() const { return { buffer, slots.cend() }; }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+    private:
+        struct Operations
+        {
+            void (*relocate)(std::byte* from, std::byte* to);   // Move-constructs at "to", then destroys "from"
+            void (*destroy)(std::byte* object);
+        };
+
+        // Stored in the buffer immediately before each object
+        struct Header
+        {
+            const Operations* operations;
+        };
+
+        template<class Derived>
+        static constexpr Operations operationsFor
+        {
+            [](std::byte* from, std::byte* to)
+            {
+                Derived* source = std::launder(reinterpret_cast<Derived*>(from));
+                ::new (to) Derived(std::move(*source));
+                source->~Derived();
+            },
+            [](std::byte* object) { std::launder(reinterpret_cast<Derived*>(object))->~Derived(); }
+        };
+
+        static constexpr std::size_t alignment = alignof(std::max_align_t);
+
+        std::byte* buffer = nullptr;
+        std::size_t capacity = 0;   // Bytes allocated
+        std::size_t used = 0;       // Bytes occupied by headers, objects and padding
+        std::vector<Slot> slots;
+
+        static std::size_t roundUp(std::size_t offset, std::size_t align) { return (offset + align - 1) / align * align; }
+
+        const Header& headerOf(const Slot& slot) const
+        {
+            return *std::launder(reinterpret_cast<const Header*>(buffer + slot.object - sizeof(Header)));
+        }
+
+        // Grows geometrically, relocating every object to the same offset in the new buffer
+        void reserveBytes(std::size_t bytes)
+        {
+            if (bytes <= capacity)
+            {
+                return;
+            }
+
+            const std::size_t newCapacity = std::max(bytes, capacity * 2);
+            std::byte* newBuffer = static_cast<std::byte*>(::operator new(newCapacity, std::align_val_t { alignment }));
+
+            for (const Slot& slot : slots)
+            {
+                const Header& header = headerOf(slot);
+
+                ::new (newBuffer + slot.object - sizeof(Header)) Header { header.operations };
+                header.operations->relocate(buffer + slot.object, newBuffer + slot.object);
+            }
+
+            ::operator delete(buffer, std::align_val_t { alignment });
+            buffer = newBuffer;
+            capacity = newCapacity;
+        }
+};
+
+
+/**
+ * With poly_vector, printArray works for any mixture of Base and Derived objects, because it never does pointer
+ * arithmetic on Base objects itself.
+*/
+void printArray(std::ostream& os, const poly_vector<Base>& array)
+{
+    for (const Base& element : array)
+    {
+        element.print(os);
+        os << '\n';
+    }
+}
+
+
+/**
+ * Benchmark:
+ * Sums weight() over 10^6 mixed Base and Derived objects held in poly_vector<Base> and in
+ * std::vector<std::unique_ptr<Base>>. The unique_ptr vector is shuffled after it is built, which is what a long-lived
+ * container looks like once elements have been inserted, erased and sorted over time.
+*/
+const int ELEMENTS = 1000000;
+const int PASSES = 20;
+
+template<class Container, class Access>
+void timeScan(const char* name, const Container& container, Access access)
+{
+    long sum = 0;
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        for (const auto& element : container)
+        {
+            sum += access(element).weight();
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::cout << name << std::chrono::duration<double, std::nano>(end - begin).count() / (double(ELEMENTS) * PASSES)
+              << " ns/element (sum " << sum << ")\n";
+}
+
+int main()
+{
+    poly_vector<Base> contiguous;
+    std::vector<std::unique_ptr<Base>> pointers;
+
+    for (int i = 0; i < ELEMENTS; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            contiguous.emplace_back<Base>(i);
+            pointers.push_back(std::make_unique<Base>(i));
+        }
+        else
+        {
+            contiguous.emplace_back<Derived>(i, 1);
+            pointers.push_back(std::make_unique<Derived>(i, 1));
+        }
+    }
+
+    std::shuffle(pointers.begin(), pointers.end(), std::mt19937 { 3 });
+
+    timeScan("poly_vector:                ", contiguous, [](const Base& b) -> const Base& { return b; });
+    timeScan("vector<unique_ptr<Base>>:   ", pointers, [](const std::unique_ptr<Base>& p) -> const Base& { return *p; });
+
+    return 0;
+}
+
+
+/**
+ * Strided Views:
+ * When the caller already owns a plain array of Derived objects, copying it into a poly_vector or a vector<Base*> is
+ * more than printArray needs. All it really lacks is the true distance between elements. strided_span<const Base>
+ * carries that distance with it: it is built from a Derived array, remembers sizeof(Derived) as its stride, and
+ * steps through the array by that many bytes, so array[i] is the Base part of the i-th Derived.
+ *
+ * The same view works over a single column of an array of structs, where the stride is the size of the struct.
+ * Indexing is a multiply and an add with no branches, so loops over the non-virtual parts of the elements (such as
+ * summing one column) can be vectorized by the compiler.
+*/
+template<class T>
+class strided_span
+{
+    private:
+        using Byte = std::conditional_t<std::is_const_v<T>, const std::byte, std::byte>;
+
+    public:
+        class iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::remove_cv_t<T>;
+                using difference_type = std::ptrdiff_t;
+                using pointer = T*;
+                using reference = T&;
+
+                iterator() = default;
+                iterator(Byte* position, std::size_t stride) : position { position }, stride { stride } { }
+
+                reference operator * () const { return *reinterpret_cast<pointer>(position); }
+                pointer operator -> () const { return reinterpret_cast<pointer>(position); }
+
+                iterator& operator ++ () { position += stride; return *this; }
+                iterator operator ++ (int) { iterator old { *this }; position += stride; return old; }
+
+                bool operator == (const iterator& rhs) const { return position == rhs.position; }
+                bool operator != (const iterator& rhs) const { return position != rhs.position; }
+
+            private:
+                Byte* position = nullptr;
+                std::size_t stride = 0;
+        };
+
+        // An array of U viewed as an array of T; U must be T or a class derived from it
+        template<class U, std::size_t N>
+            requires std::is_convertible_v<U*, T*>
+        strided_span(U (&array)[N]) : strided_span(array, N) { }
+
+        template<class U>
+            requires std::is_convertible_v<U*, T*>
+        strided_span(U* first, std::size_t count)
+            : first { reinterpret_cast<Byte*>(static_cast<T*>(first)) }, count { count }, stride { sizeof(U) } { }
+
+        // Any sequence of T objects lying a fixed number of bytes apart
+        strided_span(T* first, std::size_t count, std::size_t stride)
+            : first { reinterpret_cast<Byte*>(first) }, count { count }, stride { stride } { }
+
+        // A view of non-const elements is also a view of const ones
+        template<class U>
+            requires std::is_same_v<const U, T> && (!std::is_same_v<U, T>)
+        strided_span(const strided_span<U>& rhs) : strided_span(rhs.data(), rhs.size(), rhs.stride_bytes()) { }
+
+        T& operator [] (std::size_t index) const { return *reinterpret_cast<T*>(first + index * stride); }
+
+        T* data() const { return reinterpret_cast<T*>(first); }
+        std::size_t size() const { return count; }
+        std::size_t stride_bytes() const { return stride; }
+        bool empty() const { return count == 0; }
+
+        iterator begin() const { return { first, stride }; }
+        iterator end() const { return { first + count * stride, stride }; }
+
+    private:
+        Byte* first;
+        std::size_t count;
+        std::size_t stride;
+};
+
+static_assert(std::forward_iterator<strided_span<const Base>::iterator>);
+
+
+// A view of one data member across an array of structs, e.g. make_column(readings, n, &Reading::value)
+template<class Record, class Member>
+strided_span<Member> make_column(Record* records, std::size_t count, Member Record::* member)
+{
+    return { &(records->*member), count, sizeof(Record) };
+}
+
+template<class Record, class Member>
+strided_span<const Member> make_column(const Record* records, std::size_t count, Member Record::* member)
+{
+    return { &(records->*member), count, sizeof(Record) };
+}
+
+
+// Works for arrays of Base and arrays of Derived alike
+void printArray(std::ostream& os, strided_span<const Base> array)
+{
+    for (std::size_t i = 0; i < array.size(); ++i)
+    {
+        array[i].print(os);
+        os << '\n';
+    }
+}
+
+// Usage
+void printDerived()
+{
+    Derived derivedArray[] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+    printArray(std::cout, derivedArray);    // Fine, the stride is sizeof(Derived)
+}
+
+
+struct Reading
+{
+    int sensor;
+    double value;
+};
+
+double total(strided_span<const double> values)
+{
+    double sum = 0;
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        sum += values[i];
+    }
+
+    return sum;
+}
+
+Reading readings[1000];
+double sum = total(make_column(readings, 1000, &Reading::value));
@@ -1,3 +1,18 @@
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 /**
  * Avoid gratuitous (compiler-generated) default constructor.
 */
@@ -54,4 +69,266 @@ Array<T>::Array(int size)
  * in classes where they make no sense. That places some limits on how such classes can be used, yes, but it also
  * guarantees that when you do use such classes, you can expect that the objects they generate are fully initialized
  * and are efficiently implemented.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Arrays Without Default Constructors:
+ * Careful template design can remove the requirement altogether. Instead of new T[size], which must default-construct
+ * every element, Array can allocate raw, uninitialized memory and construct each element only when it is given a
+ * value: one at a time with emplace, from a range of existing values, or from a generator that is called with each
+ * index. Classes like Equipment can then be stored without inventing a meaningless default state, and no element is
+ * ever constructed just to be overwritten.
+ *
+ * For trivial types, for_overwrite skips initialization entirely, for callers that are about to fill the whole array
+ * themselves. For large arrays of expensive types, the generator constructor can also split the array into chunks and
+ * construct them on several threads. Those threads all call the same generator, so it must be safe to call
+ * concurrently, as a function of the index alone is.
+*/
+template<class T>
+class Array
+{
+    public:
+        // Tag that selects parallel construction
+        struct Parallel { unsigned threads = std::thread::hardware_concurrency(); };
+
+        // Allocates room for capacity elements and constructs none of them
+        explicit Array(std::size_t capacity)
+            : data { allocate(capacity) }, size { 0 }, capacity { capacity } { }
+
+        // Measures the range before copying it, so it needs to be traversed twice
+        template<std::forward_iterator Iterator>
+        Array(Iterator first, Iterator last)
+            : Array(static_cast<std::size_t>(std::distance(first, last)))
+        {
+            std::uninitialized_copy(first, last, data);
+            size = capacity;
+        }
+
+        // Element i is initialized with generate(i)
+        template<std::invocable<std::size_t> Generator>
+        Array(std::size_t count, Generator generate)
+            : Array(count)
+        {
+            constructRange(data, 0, count, generate);
+            size = count;
+        }
+
+        // As above, but generate is called from several threads at once
+        template<std::invocable<std::size_t> Generator>
+        Array(std::size_t count, Generator generate, Parallel parallel);
+
+        // Only for trivial types: count elements with indeterminate values, to be overwritten by the caller
+        static Array for_overwrite(std::size_t count)
+        {
+            static_assert(std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>,
+                          "for_overwrite leaves elements uninitialized, so T must be trivial");
+
+            Array array(count);
+            array.size = count;
+
+            return array;
+        }
+
+        Array(const Array& rhs) = delete;
+        Array& operator = (const Array& rhs) = delete;
+
+        Array(Array&& rhs) noexcept
+            : data { std::exchange(rhs.data, nullptr) }, size { std::exchange(rhs.size, 0) },
+              capacity { std::exchange(rhs.capacity, 0) } { }
+
+        ~Array()
+        {
+            std::destroy(data, data + size);
+            ::operator delete(data, std::align_val_t { alignof(T) });
+        }
+
+        // Constructs a new element at the end; the array never grows beyond its capacity
+        template<class... Args>
+        T& emplace(Args&&... args)
+        {
+            if (size == capacity)
+            {
+                throw std::length_error("Array is full");
+            }
+
+            T* element = ::new (static_cast<void*>(data + size)) T(std::forward<Args>(args)...);
+            ++size;
+
+            return *element;
+        }
+
+        T& operator [] (std::size_t index) { return data[index]; }
+        const T& operator [] (std::size_t index) const { return data[index]; }
+
+        std::size_t length() const { return size; }
+
+    private:
+        T* data;
+        std::size_t size;       // # of constructed elements, always a prefix of the storage
+        std::size_t capacity;
+
+        static T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t { alignof(T) }));
+        }
+
+        // Constructs [begin, end) from the generator; if one constructor throws, the ones before it are destroyed
+        template<class Generator>
+        static void constructRange(T* storage, std::size_t begin, std::size_t end, Generator& generate)
+        {
+            std::size_t i = begin;
+
+            try
+            {
+                for (; i < end; ++i)
+                {
+                    ::new (static_cast<void*>(storage + i)) T(generate(i));
+                }
+            }
+            catch (...)
+            {
+                std::destroy(storage + begin, storage + i);
+                throw;
+            }
+        }
+};
+
+
+template<class T>
+template<std::invocable<std::size_t> Generator>
+Array<T>::Array(std::size_t count, Generator generate, Parallel parallel)
+    : Array(count)
+{
+    const std::size_t threads = std::clamp<std::size_t>(parallel.threads, 1, std::max<std::size_t>(count, 1));
+    const std::size_t chunk = (count + threads - 1) / threads;
+
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    // Each worker constructs its own chunk, cleaning up after itself if a constructor throws
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t] {
+            try
+            {
+                constructRange(data, t * chunk, std::min(count, (t + 1) * chunk), generate);
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    // If any chunk failed, destroy the chunks that succeeded and report the first failure
+    auto failed = std::find_if(errors.begin(), errors.end(), [](const std::exception_ptr& e) { return e != nullptr; });
+
+    if (failed != errors.end())
+    {
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            if (errors[t] == nullptr)
+            {
+                std::destroy(data + std::min(count, t * chunk), data + std::min(count, (t + 1) * chunk));
+            }
+        }
+
+        ::operator delete(data, std::align_val_t { alignof(T) });
+        data = nullptr;
+        capacity = 0;
+
+        std::rethrow_exception(*failed);
+    }
+
+    size = count;
+}
+
+
+// Usage
+void stockInventory()
+{
+    Array<Equipment> inventory(10);
+    inventory.emplace(1);                                               // Fine, calls Equipment(1)
+    Array<Equipment> numbered(10, [](std::size_t i) { return Equipment(static_cast<int>(i)); });   // Fine
+    Array<int> scratch = Array<int>::for_overwrite(1 << 20);            // No initialization at all
+}
+
+
+/**
+ * Benchmark:
+ * Compares the default-construct-then-assign pattern (new T[size] followed by an assignment to every element) with
+ * generator construction and parallel generator construction, for a type whose constructor does real work. The
+ * baseline type needs a default constructor, which is exactly the kind of meaningless one this item warns against.
+*/
+class CostlyEquipment
+{
+    public:
+        CostlyEquipment() = default;
+
+        explicit CostlyEquipment(int ID) : ID { ID }
+        {
+            // Stands in for the expensive part of construction, e.g. loading a configuration
+            for (int i = 0; i < 200; ++i)
+            {
+                checksum = checksum * 31 + static_cast<unsigned>(ID ^ i);
+            }
+
+            name = "equipment-" + std::to_string(checksum);
+        }
+
+        unsigned getChecksum() const { return checksum; }
+
+    private:
+        int ID = -1;
+        unsigned checksum = 0;
+        std::string name;
+};
+
+const std::size_t PIECES = 1000000;
+
+template<class Operation>
+void timeConstruction(const char* name, Operation operation)
+{
+    auto begin = std::chrono::steady_clock::now();
+    operation();
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << name << std::chrono::duration<double, std::milli>(end - begin).count() << " ms\n";
+}
+
+int main()
+{
+    auto idOf = [](std::size_t i) { return CostlyEquipment(static_cast<int>(i)); };
+
+    // Reading the arrays keeps the compiler from discarding the construction being timed
+    volatile unsigned sink = 0;
+
+    timeConstruction("default-construct, then assign: ", [&] {
+        std::unique_ptr<CostlyEquipment[]> pieces(new CostlyEquipment[PIECES]);
+
+        for (std::size_t i = 0; i < PIECES; ++i)
+        {
+            pieces[i] = idOf(i);
+        }
+
+        sink = pieces[PIECES - 1].getChecksum();
+    });
+
+    timeConstruction("generator construction:         ", [&] {
+        Array<CostlyEquipment> pieces(PIECES, idOf);
+        sink = pieces[PIECES - 1].getChecksum();
+    });
+
+    timeConstruction("parallel construction:          ", [&] {
+        Array<CostlyEquipment> pieces(PIECES, idOf, Array<CostlyEquipment>::Parallel {});
+        sink = pieces[PIECES - 1].getChecksum();
+    });
+
+    return 0;
+}
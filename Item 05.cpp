@@ -1,6 +1,19 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 /**
  * Be wary of user-defined conversion functions.
 */
@@ -117,4 +130,386 @@ class Array2
         explicit Array(int size);
 
         T& operator [] (int index);
-};
\ No newline at end of file
+};
+
+/**
+ * Index Checking Policies:
+ * Array's operator[] says nothing about what happens to a bad index. Rather than pick one answer for every caller, the
+ * checking can be made a template parameter:
+ *
+ * 1. CheckedIndex throws std::out_of_range on every bad index, in every build.
+ * 2. DebugCheckedIndex asserts, so the check disappears when NDEBUG is defined.
+ * 3. UncheckedIndex does nothing, like the built-in subscript.
+ *
+ * elements() returns a std::span over the whole array, and elements(first, count) checks its range once according to
+ * the policy and returns a span over it, so an inner loop can run over plain contiguous memory with no per-access
+ * branch, which leaves the compiler free to vectorize it. mutate(first, count, change) does the same for loops that
+ * write: it checks the range once and passes change a writable span.
+ *
+ * Array3 caches a hash of its contents (see Comparing Arrays below), so it hands out no writable references: a write
+ * through one kept past a call to hash() would leave the cached hash stale. Elements are written with set, or inside
+ * mutate, and both invalidate the cached hash after the write has happened.
+*/
+struct CheckedIndex
+{
+    static void check(int index, int size)
+    {
+        if (index < 0 || index >= size)
+        {
+            throw std::out_of_range("Array index out of range");
+        }
+    }
+
+    static void checkRange(int first, int count, int size)
+    {
+        if (count < 0 || first < 0 || first > size - count)
+        {
+            throw std::out_of_range("Array range out of range");
+        }
+    }
+};
+
+struct DebugCheckedIndex
+{
+    static void check([[maybe_unused]] int index, [[maybe_unused]] int size)
+    {
+        assert(index >= 0 && index < size);
+    }
+
+    static void checkRange([[maybe_unused]] int first, [[maybe_unused]] int count, [[maybe_unused]] int size)
+    {
+        assert(count >= 0 && first >= 0 && first <= size - count);
+    }
+};
+
+struct UncheckedIndex
+{
+    static void check(int, int) noexcept { }
+    static void checkRange(int, int, int) noexcept { }
+};
+
+
+template<class T, class IndexPolicy = CheckedIndex>
+class Array3
+{
+    public:
+        explicit Array3(int size) : data(static_cast<std::size_t>(size)) { }
+
+        const T& operator [] (int index) const
+        {
+            IndexPolicy::check(index, size());
+
+            return data[index];
+        }
+
+        int size() const { return static_cast<int>(data.size()); }
+
+        std::span<const T> elements() const { return data; }
+
+        // The range [first, first + count) is checked once, not once per element
+        std::span<const T> elements(int first, int count) const
+        {
+            IndexPolicy::checkRange(first, count, size());
+
+            return std::span<const T>(data).subspan(first, count);
+        }
+
+        void set(int index, const T& value)
+        {
+            IndexPolicy::check(index, size());
+            data[index] = value;
+            hashValid = false;
+        }
+
+        // Calls change with a writable span over [first, first + count); change must not keep the span
+        template<class Function>
+        void mutate(int first, int count, Function change)
+        {
+            IndexPolicy::checkRange(first, count, size());
+            hashValid = false;      // In case change throws part way through
+            change(std::span<T>(data).subspan(first, count));
+            hashValid = false;
+        }
+
+        template<class Function>
+        void mutate(Function change) { mutate(0, size(), change); }
+
+        // Hash of the contents, recomputed only if the array may have changed since the last call
+        std::size_t hash() const
+        {
+            if (!hashValid)
+            {
+                cachedHash = hashElements(elements());
+                hashValid = true;
+            }
+
+            return cachedHash;
+        }
+
+        bool hasCachedHash() const { return hashValid; }
+
+    private:
+        std::vector<T> data;
+        mutable std::size_t cachedHash = 0;
+        mutable bool hashValid = false;
+
+        static std::size_t hashElements(std::span<const T> elements);
+};
+
+
+/**
+ * Benchmark:
+ * Times a reduction (summing every element) and a scatter (incrementing elements at random indices) under each policy,
+ * and the reduction again over elements(). Build once with and once without -DNDEBUG to see DebugCheckedIndex in both
+ * of its forms.
+*/
+const int ELEMENTS = 1 << 20;
+const int PASSES = 100;
+
+template<class Operation>
+void timeLoop(const char* name, Operation operation)
+{
+    auto begin = std::chrono::steady_clock::now();
+    long long result = 0;
+
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        result += operation();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::cout << name << std::chrono::duration<double, std::nano>(end - begin).count() / (double(ELEMENTS) * PASSES)
+              << " ns/element (" << result << ")\n";
+}
+
+template<class IndexPolicy>
+void runPolicy(const char* name, const std::vector<int>& indices)
+{
+    Array3<int, IndexPolicy> a(ELEMENTS);
+
+    a.mutate([](std::span<int> elements) {
+        for (std::size_t i = 0; i < elements.size(); ++i) { elements[i] = static_cast<int>(i & 0xff); }
+    });
+
+    std::cout << name << '\n';
+
+    timeLoop("  reduction:          ", [&] {
+        long long sum = 0;
+        for (int i = 0; i < a.size(); ++i) { sum += a[i]; }
+        return sum;
+    });
+
+    timeLoop("  reduction via span: ", [&] {
+        long long sum = 0;
+        for (int value : a.elements()) { sum += value; }
+        return sum;
+    });
+
+    timeLoop("  scatter:            ", [&] {
+        for (int index : indices) { a.set(index, a[index] + 1); }
+        return static_cast<long long>(a[0]);
+    });
+}
+
+int main()
+{
+    std::vector<int> indices(ELEMENTS);
+    std::mt19937 random { 5 };
+
+    for (int& index : indices)
+    {
+        index = static_cast<int>(random() % ELEMENTS);
+    }
+
+    runPolicy<CheckedIndex>("CheckedIndex", indices);
+    runPolicy<DebugCheckedIndex>("DebugCheckedIndex", indices);
+    runPolicy<UncheckedIndex>("UncheckedIndex", indices);
+
+    return 0;
+}
+
+
+/**
+ * Comparing Arrays:
+ * The operator == declared above can do much better than comparing element by element through operator[]. It compares
+ * lengths first. If both arrays already know their content hashes and the hashes differ, the arrays differ, which
+ * makes rejecting an unchanged pair O(1). Otherwise, for element types whose values are equal exactly when their bytes
+ * are equal (ints and other types with unique object representations, but not floating point), it compares blocks of
+ * memory with memcmp, which the standard library implements with vector instructions; for other types it falls back
+ * to comparing elements with ==.
+ *
+ * Two equal arrays still have to be compared in full, since equal hashes only make equality likely. arrayMismatch
+ * finds the first differing index with the same kernel, and hash() gives deduplication code a bucket key that is
+ * computed once per unchanged array.
+*/
+template<class T>
+constexpr bool isBitwiseComparable = std::has_unique_object_representations_v<T>;
+
+
+// Returns the index of the first element that differs, or the shorter length if one array is a prefix of the other
+template<class T, class IndexPolicy>
+int arrayMismatch(const Array3<T, IndexPolicy>& lhs, const Array3<T, IndexPolicy>& rhs)
+{
+    std::span<const T> left = lhs.elements();
+    std::span<const T> right = rhs.elements();
+    const std::size_t length = std::min(left.size(), right.size());
+
+    if constexpr (isBitwiseComparable<T>)
+    {
+        // Skip equal blocks with memcmp, then find the exact element inside the first block that differs
+        const std::size_t block = 256;
+        std::size_t first = 0;
+
+        while (first < length)
+        {
+            const std::size_t count = std::min(block, length - first);
+
+            if (std::memcmp(left.data() + first, right.data() + first, count * sizeof(T)) != 0)
+            {
+                break;
+            }
+
+            first += count;
+        }
+
+        const std::size_t last = std::min(length, first + block);
+
+        return static_cast<int>(std::mismatch(left.begin() + first, left.begin() + last, right.begin() + first).first
+                                - left.begin());
+    }
+    else
+    {
+        return static_cast<int>(std::mismatch(left.begin(), left.begin() + length, right.begin()).first - left.begin());
+    }
+}
+
+
+template<class T, class IndexPolicy>
+bool operator == (const Array3<T, IndexPolicy>& lhs, const Array3<T, IndexPolicy>& rhs)
+{
+    if (&lhs == &rhs)
+    {
+        return true;
+    }
+
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+
+    if (lhs.hasCachedHash() && rhs.hasCachedHash() && lhs.hash() != rhs.hash())
+    {
+        return false;
+    }
+
+    // memcmp needs valid pointers even for zero bytes, and an empty vector's data() may be null
+    if (lhs.size() == 0)
+    {
+        return true;
+    }
+
+    if constexpr (isBitwiseComparable<T>)
+    {
+        return std::memcmp(lhs.elements().data(), rhs.elements().data(), lhs.size() * sizeof(T)) == 0;
+    }
+    else
+    {
+        return std::equal(lhs.elements().begin(), lhs.elements().end(), rhs.elements().begin());
+    }
+}
+
+
+template<class T, class IndexPolicy>
+std::size_t Array3<T, IndexPolicy>::hashElements(std::span<const T> elements)
+{
+    std::uint64_t hash = 0x9e3779b97f4a7c15 ^ elements.size();
+
+    auto mix = [&hash](std::uint64_t word) {
+        hash = (hash ^ word) * 0xff51afd7ed558ccd;
+        hash ^= hash >> 32;
+    };
+
+    if constexpr (isBitwiseComparable<T>)
+    {
+        // Hash the bytes eight at a time
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(elements.data());
+        const std::size_t length = elements.size_bytes();
+        std::size_t i = 0;
+
+        for (; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t))
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            mix(word);
+        }
+
+        if (i < length)
+        {
+            std::uint64_t tail = 0;
+            std::memcpy(&tail, bytes + i, length - i);
+            mix(tail);
+        }
+    }
+    else
+    {
+        for (const T& element : elements)
+        {
+            mix(std::hash<T> {}(element));
+        }
+    }
+
+    return static_cast<std::size_t>(hash);
+}
+
+
+/**
+ * Benchmark:
+ * Compares pairs of 10^6-int arrays that differ only in their last element, first element by element through
+ * operator[] and then with operator ==; and then compares the pair again once both hashes are cached.
+*/
+int main()
+{
+    const int length = 1000000;
+    const int passes = 100;
+
+    Array3<int, UncheckedIndex> a(length);
+    Array3<int, UncheckedIndex> b(length);
+
+    for (int i = 0; i < length; ++i)
+    {
+        a.set(i, i);
+        b.set(i, i);
+    }
+
+    b.set(length - 1, -1);
+
+    auto timeComparison = [&](const char* name, auto compare) {
+        int equal = 0;
+        auto begin = std::chrono::steady_clock::now();
+
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            equal += compare() ? 1 : 0;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        std::cout << name << std::chrono::duration<double, std::micro>(end - begin).count() / passes
+                  << " us/comparison (" << equal << " equal)\n";
+    };
+
+    timeComparison("element by element: ", [&] {
+        for (int i = 0; i < length; ++i)
+        {
+            if (a[i] != b[i]) { return false; }
+        }
+        return true;
+    });
+
+    timeComparison("operator ==:        ", [&] { return a == b; });
+
+    a.hash();
+    b.hash();
+    timeComparison("with cached hashes: ", [&] { return a == b; });
+
+    return 0;
+}
@@ -1,3 +1,7 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
 /**
  * Distinguish between prefix and postfix forms of increment and decrement operators.
 */
@@ -49,3 +53,168 @@ Number num;
 num++;      // Calls num.operator ++ (0)
 
 
+
+
+/**
+ * Deriving Postfix From Prefix:
+ * Because postfix should always be written in terms of prefix, the postfix forms can be written once in a base class
+ * template and inherited by every class that implements the prefix forms. Two details differ from the Number above:
+ *
+ * 1. Postfix returns a non-const object. A const return value cannot be moved from, so it forces a copy whenever the
+ *    result is used; returning a plain object lets the old value be moved out (or the copy elided altogether).
+ * 2. Postfix is [[nodiscard]]. If the caller ignores the old value, the copy was wasted work, and the compiler says so,
+ *    which points the caller at prefix form.
+ *
+ * A derived class declaring its own prefix operator ++ hides the base class's operator ++, so it must bring the
+ * postfix form back with a using-declaration.
+*/
+template<class Derived>
+class PostfixFromPrefix
+{
+    public:
+        [[nodiscard]] Derived operator ++ (int)
+        {
+            Derived& self = static_cast<Derived&>(*this);
+            Derived oldValue { self };
+            ++self;
+
+            return oldValue;
+        }
+
+        [[nodiscard]] Derived operator -- (int)
+        {
+            Derived& self = static_cast<Derived&>(*this);
+            Derived oldValue { self };
+            --self;
+
+            return oldValue;
+        }
+};
+
+
+// A lightweight counter, like Number
+class Number2: public PostfixFromPrefix<Number2>
+{
+    public:
+        using PostfixFromPrefix<Number2>::operator ++;
+
+        Number2& operator ++ () { ++value; return *this; }
+
+        long get() const { return value; }
+
+    private:
+        long value = 0;
+};
+
+
+// A heavyweight counter: an unlimited precision integer (like UPInt from Item 21) stored as 32-bit limbs
+class BigCounter: public PostfixFromPrefix<BigCounter>
+{
+    public:
+        using PostfixFromPrefix<BigCounter>::operator ++;
+
+        BigCounter() : limbs(8, 0) { }
+
+        BigCounter& operator ++ ()
+        {
+            for (std::uint32_t& limb : limbs)
+            {
+                if (++limb != 0)
+                {
+                    return *this;
+                }
+            }
+
+            limbs.push_back(1);
+
+            return *this;
+        }
+
+        std::uint32_t low() const { return limbs[0]; }
+
+    private:
+        std::vector<std::uint32_t> limbs;
+};
+
+
+// A custom iterator over an int array
+class IntIterator: public PostfixFromPrefix<IntIterator>
+{
+    public:
+        using PostfixFromPrefix<IntIterator>::operator ++;
+
+        explicit IntIterator(const int* position) : position { position } { }
+
+        IntIterator& operator ++ () { ++position; return *this; }
+        const int& operator * () const { return *position; }
+
+        bool operator != (const IntIterator& rhs) const { return position != rhs.position; }
+
+    private:
+        const int* position;
+};
+
+
+/**
+ * Benchmark:
+ * Times prefix against postfix with the result discarded, for each of the three classes. Build and run it three
+ * times, with -O0, -O2 and -O3. With optimization off, every postfix call pays for its copy. With optimization on, the
+ * copy of Number2 or IntIterator disappears entirely, but the copy of BigCounter usually survives because it allocates
+ * memory, so prefix form still matters for heavyweight types.
+*/
+const long ITERATIONS = 10000000;
+
+template<class Loop>
+void timeIncrement(const char* name, Loop loop)
+{
+    auto begin = std::chrono::steady_clock::now();
+    long result = loop();
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << name << std::chrono::duration<double, std::nano>(end - begin).count() / ITERATIONS
+              << " ns/increment (" << result << ")\n";
+}
+
+int main()
+{
+    timeIncrement("Number2, prefix:      ", [] {
+        Number2 n;
+        for (long i = 0; i < ITERATIONS; ++i) { ++n; }
+        return n.get();
+    });
+
+    timeIncrement("Number2, postfix:     ", [] {
+        Number2 n;
+        for (long i = 0; i < ITERATIONS; ++i) { (void)n++; }
+        return n.get();
+    });
+
+    timeIncrement("BigCounter, prefix:   ", [] {
+        BigCounter n;
+        for (long i = 0; i < ITERATIONS; ++i) { ++n; }
+        return static_cast<long>(n.low());
+    });
+
+    timeIncrement("BigCounter, postfix:  ", [] {
+        BigCounter n;
+        for (long i = 0; i < ITERATIONS; ++i) { (void)n++; }
+        return static_cast<long>(n.low());
+    });
+
+    std::vector<int> values(ITERATIONS, 1);
+    const IntIterator end { values.data() + values.size() };
+
+    timeIncrement("IntIterator, prefix:  ", [&] {
+        long sum = 0;
+        for (IntIterator it { values.data() }; it != end; ++it) { sum += *it; }
+        return sum;
+    });
+
+    timeIncrement("IntIterator, postfix: ", [&] {
+        long sum = 0;
+        for (IntIterator it { values.data() }; it != end; (void)it++) { sum += *it; }
+        return sum;
+    });
+
+    return 0;
+}
@@ -1,5 +1,23 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
 #include <string>
+#include <vector>
+
+#ifdef __linux__
+    #include <cxxabi.h>
+    #include <dlfcn.h>
+    #include <execinfo.h>
+#endif
 /**
  * Understand the different meanings of new and delete.
  *
@@ -121,4 +139,447 @@ Example* p_e { constructExampleInBuffer(sharedMemory, 10) };
 p_e->~Example();
 
 // Fine, deallocates the memory pointer to by p_e, but calls no destructor
-freeShared(p_e);
\ No newline at end of file
+freeShared(p_e);
+
+/**
+ * Profiling the Heap:
+ * Because every new operator goes through operator new, replacing the global operator new and operator delete is
+ * also the way to find out where a program's memory goes. Recording every allocation would slow the program down too
+ * much to be useful, so HeapProfiler samples: on average one allocation is recorded for every sampleInterval bytes
+ * allocated, with the interval drawn at random so that allocations of all sizes are sampled fairly.
+ *
+ * For each sampled allocation it captures the stack with backtrace(). Allocations are grouped by stack into call
+ * sites, and each site keeps counts and bytes for allocations still live and for all allocations ever made. Every
+ * block carries a 16-byte header that names its call site (or none, if it wasn't sampled), so operator delete knows
+ * which site to charge without any lookup. Unsampled allocations cost a thread-local subtraction and the header.
+ *
+ * writeTop() prints the call sites with the most live (or most allocated) bytes, scaled up to estimate the unsampled
+ * total. writePprof() writes the raw samples in the legacy heap profile format that pprof reads. The profiler is only
+ * compiled with -DHEAP_PROFILE, and needs -rdynamic for writeTop() to print function names.
+*/
+#if defined(HEAP_PROFILE) && defined(__linux__)
+
+class HeapProfiler
+{
+    public:
+        static inline std::size_t sampleInterval = 512 * 1024;     // Average bytes between samples
+
+        static void* allocate(std::size_t size, std::size_t alignment)
+        {
+            const std::size_t headerSize = std::max(sizeof(Header), alignment);
+            void* block = alignment <= alignof(std::max_align_t)
+                          ? std::malloc(headerSize + size)
+                          : std::aligned_alloc(alignment, (headerSize + size + alignment - 1) / alignment * alignment);
+
+            if (block == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+
+            std::byte* user = static_cast<std::byte*>(block) + headerSize;
+            Header* header = reinterpret_cast<Header*>(user) - 1;
+            header->site = nullptr;
+            header->size = size;
+
+            ThreadState& state = threadState;
+            state.bytesUntilSample -= static_cast<std::int64_t>(size);
+
+            if (state.bytesUntilSample <= 0 && !state.busy)
+            {
+                // A thread's first allocation only draws its first interval, so that it isn't always sampled
+                if (!state.seeded)
+                {
+                    state.seed();
+                    state.bytesUntilSample += state.nextInterval();
+                }
+
+                if (state.bytesUntilSample <= 0)
+                {
+                    state.bytesUntilSample = state.nextInterval();
+                    header->site = sample(size);
+                }
+            }
+
+            return user;
+        }
+
+        static void deallocate(void* user, std::size_t alignment) noexcept
+        {
+            if (user == nullptr)
+            {
+                return;
+            }
+
+            Header* header = static_cast<Header*>(user) - 1;
+
+            if (header->site != nullptr)
+            {
+                header->site->liveCount.fetch_sub(1, std::memory_order_relaxed);
+                header->site->liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+            }
+
+            std::free(static_cast<std::byte*>(user) - std::max(sizeof(Header), alignment));
+        }
+
+        // The n call sites with the most live bytes (or, if cumulative, the most bytes ever allocated)
+        static void writeTop(std::ostream& os, std::size_t n, bool cumulative = false)
+        {
+            Busy busy;
+            std::vector<const CallSite*> sites = snapshot();
+
+            auto bytesOf = [cumulative](const CallSite* site) {
+                return cumulative ? site->allocatedBytes.load() : site->liveBytes.load();
+            };
+
+            std::sort(sites.begin(), sites.end(), [&](const CallSite* a, const CallSite* b) {
+                return bytesOf(a) > bytesOf(b);
+            });
+
+            sites.resize(std::min(n, sites.size()));
+
+            for (const CallSite* site : sites)
+            {
+                const std::uint64_t count = cumulative ? site->allocatedCount.load() : site->liveCount.load();
+                const std::uint64_t bytes = bytesOf(site);
+
+                os << std::setw(12) << estimate(bytes, count) << " bytes " << std::setw(10)
+                   << estimate(count, count, bytes) << " objects  (" << count << " samples)\n";
+
+                char** symbols = backtrace_symbols(site->frames, static_cast<int>(site->depth));
+
+                for (std::size_t i = firstCallerFrame(*site); i < site->depth; ++i)
+                {
+                    os << "        " << (symbols != nullptr ? symbols[i] : "?") << '\n';
+                }
+
+                std::free(symbols);
+            }
+        }
+
+        // Legacy gperftools heap profile, e.g. "pprof --text ./program heap.prof"
+        static void writePprof(std::ostream& os)
+        {
+            Busy busy;
+            std::vector<const CallSite*> sites = snapshot();
+            std::uint64_t liveCount = 0, liveBytes = 0, allocatedCount = 0, allocatedBytes = 0;
+
+            for (const CallSite* site : sites)
+            {
+                liveCount += site->liveCount;
+                liveBytes += site->liveBytes;
+                allocatedCount += site->allocatedCount;
+                allocatedBytes += site->allocatedBytes;
+            }
+
+            os << "heap profile: " << liveCount << ": " << liveBytes << " [" << allocatedCount << ": " << allocatedBytes
+               << "] @ heap_v2/" << sampleInterval << '\n';
+
+            for (const CallSite* site : sites)
+            {
+                os << site->liveCount << ": " << site->liveBytes << " [" << site->allocatedCount << ": "
+                   << site->allocatedBytes << "] @";
+
+                for (std::size_t i = firstCallerFrame(*site); i < site->depth; ++i)
+                {
+                    os << ' ' << site->frames[i];
+                }
+
+                os << '\n';
+            }
+
+            std::ifstream maps { "/proc/self/maps" };
+            os << "\nMAPPED_LIBRARIES:\n" << maps.rdbuf();
+        }
+
+    private:
+        static constexpr std::size_t maxDepth = 32;
+        static constexpr std::size_t tableSize = 1 << 14;  // Distinct call sites
+
+        struct CallSite
+        {
+            std::atomic<std::uint64_t> hash { 0 };      // 0 until the site is published
+            std::size_t depth = 0;
+            void* frames[maxDepth];
+
+            std::atomic<std::uint64_t> liveCount { 0 };
+            std::atomic<std::uint64_t> liveBytes { 0 };
+            std::atomic<std::uint64_t> allocatedCount { 0 };
+            std::atomic<std::uint64_t> allocatedBytes { 0 };
+        };
+
+        struct alignas(16) Header
+        {
+            CallSite* site;     // Null unless the allocation was sampled
+            std::size_t size;
+        };
+
+        struct ThreadState
+        {
+            std::int64_t bytesUntilSample = 0;
+            std::uint64_t random = 0x9e3779b97f4a7c15;
+            bool busy = false;      // Set while the profiler itself runs, so its own allocations aren't sampled
+            bool seeded = false;
+
+            // Gives each thread its own sequence of intervals
+            void seed()
+            {
+                random ^= reinterpret_cast<std::uintptr_t>(this) * 0xff51afd7ed558ccd;
+                random = random != 0 ? random : 0x9e3779b97f4a7c15;
+                seeded = true;
+            }
+
+            // Exponentially distributed, with mean sampleInterval
+            std::int64_t nextInterval()
+            {
+                random ^= random << 13;
+                random ^= random >> 7;
+                random ^= random << 17;
+
+                const double uniform = (double(random >> 11) + 1) / 9007199254740993.0;
+
+                return static_cast<std::int64_t>(-std::log(uniform) * double(sampleInterval)) + 1;
+            }
+        };
+
+        class Busy
+        {
+            public:
+                Busy() : state { threadState }, previous { state.busy } { state.busy = true; }
+                ~Busy() { state.busy = previous; }
+
+            private:
+                ThreadState& state;
+                bool previous;
+        };
+
+        static thread_local ThreadState threadState;
+        static CallSite table[tableSize];
+
+        static CallSite* sample(std::size_t size)
+        {
+            Busy busy;
+            void* frames[maxDepth];
+            const int depth = backtrace(frames, maxDepth);
+
+            std::uint64_t hash = 0xcbf29ce484222325;
+
+            for (int i = 0; i < depth; ++i)
+            {
+                hash = (hash ^ reinterpret_cast<std::uintptr_t>(frames[i])) * 0x100000001b3;
+            }
+
+            hash |= 1;      // 0 marks an empty slot
+
+            CallSite* site = find(hash, frames, static_cast<std::size_t>(depth));
+
+            if (site != nullptr)
+            {
+                site->liveCount.fetch_add(1, std::memory_order_relaxed);
+                site->liveBytes.fetch_add(size, std::memory_order_relaxed);
+                site->allocatedCount.fetch_add(1, std::memory_order_relaxed);
+                site->allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+            }
+
+            return site;
+        }
+
+        // Finds the site for a stack, claiming an empty slot for a new one; returns null if the table is full
+        static CallSite* find(std::uint64_t hash, void* const* frames, std::size_t depth)
+        {
+            static std::mutex insertMutex;
+
+            for (std::size_t probe = 0; probe < tableSize; ++probe)
+            {
+                CallSite& site = table[(hash + probe) & (tableSize - 1)];
+                std::uint64_t existing = site.hash.load(std::memory_order_acquire);
+
+                if (existing == 0)
+                {
+                    std::lock_guard<std::mutex> lock { insertMutex };
+                    existing = site.hash.load(std::memory_order_acquire);
+
+                    if (existing == 0)
+                    {
+                        site.depth = depth;
+                        std::copy(frames, frames + depth, site.frames);
+                        site.hash.store(hash, std::memory_order_release);
+
+                        return &site;
+                    }
+                }
+
+                if (existing == hash)
+                {
+                    return &site;
+                }
+            }
+
+            return nullptr;
+        }
+
+        static std::vector<const CallSite*> snapshot()
+        {
+            std::vector<const CallSite*> sites;
+
+            for (const CallSite& site : table)
+            {
+                if (site.hash.load(std::memory_order_acquire) != 0)
+                {
+                    sites.push_back(&site);
+                }
+            }
+
+            return sites;
+        }
+
+        // Index of the first frame outside the profiler and operator new. How many frames that is depends on what
+        // the compiler inlined, so it is found by name; without -rdynamic no names are found and nothing is skipped.
+        static std::size_t firstCallerFrame(const CallSite& site)
+        {
+            std::size_t first = 0;
+
+            for (; first < site.depth; ++first)
+            {
+                Dl_info info;
+
+                if (dladdr(site.frames[first], &info) == 0 || info.dli_sname == nullptr)
+                {
+                    break;
+                }
+
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                const std::string name = status == 0 ? demangled : info.dli_sname;
+                std::free(demangled);
+
+                if (name.rfind("HeapProfiler::", 0) != 0 && name.rfind("operator new", 0) != 0)
+                {
+                    break;
+                }
+            }
+
+            return first;
+        }
+
+        // Scales a sampled quantity up to an estimate of the total; an allocation of s bytes is sampled with
+        // probability 1 - exp(-s / sampleInterval)
+        static std::uint64_t estimate(std::uint64_t sampled, std::uint64_t count, std::uint64_t bytes = 0)
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+
+            const double averageSize = double(bytes != 0 ? bytes : sampled) / double(count);
+            const double probability = 1 - std::exp(-averageSize / double(sampleInterval));
+
+            return static_cast<std::uint64_t>(double(sampled) / probability);
+        }
+};
+
+thread_local HeapProfiler::ThreadState HeapProfiler::threadState;
+HeapProfiler::CallSite HeapProfiler::table[HeapProfiler::tableSize];
+
+
+void* operator new (std::size_t size) { return HeapProfiler::allocate(size, 0); }
+void* operator new[] (std::size_t size) { return HeapProfiler::allocate(size, 0); }
+void* operator new (std::size_t size, std::align_val_t alignment)
+{
+    return HeapProfiler::allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[] (std::size_t size, std::align_val_t alignment)
+{
+    return HeapProfiler::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return HeapProfiler::allocate(size, 0); } catch (const std::bad_alloc&) { return nullptr; }
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return HeapProfiler::allocate(size, 0); } catch (const std::bad_alloc&) { return nullptr; }
+}
+
+void operator delete (void* memory) noexcept { HeapProfiler::deallocate(memory, 0); }
+void operator delete[] (void* memory) noexcept { HeapProfiler::deallocate(memory, 0); }
+void operator delete (void* memory, std::size_t) noexcept { HeapProfiler::deallocate(memory, 0); }
+void operator delete[] (void* memory, std::size_t) noexcept { HeapProfiler::deallocate(memory, 0); }
+void operator delete (void* memory, const std::nothrow_t&) noexcept { HeapProfiler::deallocate(memory, 0); }
+void operator delete[] (void* memory, const std::nothrow_t&) noexcept { HeapProfiler::deallocate(memory, 0); }
+
+void operator delete (void* memory, std::align_val_t alignment) noexcept
+{
+    HeapProfiler::deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[] (void* memory, std::align_val_t alignment) noexcept
+{
+    HeapProfiler::deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete (void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    HeapProfiler::deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[] (void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    HeapProfiler::deallocate(memory, static_cast<std::size_t>(alignment));
+}
+
+
+// Usage: print the ten call sites holding the most memory, and save a profile for pprof
+HeapProfiler::writeTop(std::cerr, 10);
+
+std::ofstream profile { "heap.prof" };
+HeapProfiler::writePprof(profile);
+
+#endif
+
+
+/**
+ * Benchmark:
+ * Replaces 10^7 blocks of random sizes between 16 and 4096 bytes, keeping 1024 of them live, and reports the time per
+ * allocation and deallocation. Build it with and without -DHEAP_PROFILE and compare the two. The aim is less than 5%
+ * with the default sampleInterval; in a virtual machine, where runs differ by about as much, the measured difference
+ * was 5-10%. Part of it is backtrace() on sampled allocations, which a larger sampleInterval reduces, and part is the
+ * header, which moves blocks into the next size class:
+ *
+ *     g++ -O2 -rdynamic "Item 08.cpp" -o plain
+ *     g++ -O2 -rdynamic -DHEAP_PROFILE "Item 08.cpp" -o profiled
+*/
+int main()
+{
+    constexpr int replacements = 10000000;
+
+    std::vector<char*> live(1024, nullptr);
+    std::uint64_t random = 0x2545f4914f6cdd1d;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < replacements; ++i)
+    {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+
+        char*& slot = live[random % live.size()];
+        delete[] slot;
+        slot = new char[16 + (random >> 32) % 4081];
+        slot[0] = static_cast<char>(i);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (char* block : live)
+    {
+        delete[] block;
+    }
+
+    std::cout << std::chrono::duration<double, std::nano>(end - begin).count() / replacements
+              << " ns per allocation and deallocation\n";
+
+    return 0;
+}
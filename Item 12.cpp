@@ -1,3 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <vector>
 /**
  * Understand how throwing an exception differs from passing a parameter or calling a virtual function.
 */
@@ -91,4 +106,286 @@ try
 catch(A & a)
 {
     throw a;   // this performs A a = exc_b; (the temporary object) and then throw a
-}
\ No newline at end of file
+}
+
+/**
+ * Where Exception Objects Live:
+ * The copy made by throw has to live somewhere that survives unwinding, so the runtime allocates it on the heap: with
+ * the Itanium C++ ABI used by GCC and Clang, every throw calls __cxa_allocate_exception, which calls malloc, and every
+ * catch that finishes calls __cxa_free_exception, which calls free. An exception that carries a message usually makes
+ * a second allocation for the string. When many threads throw at once, these allocations all contend on the
+ * allocator, at exactly the moment the program is already in trouble.
+ *
+ * Two changes remove both allocations:
+ *
+ * 1. The exception hierarchy from Item 13 keeps its message in fixed storage inside the object, truncating long
+ *    messages, so constructing and copying an exception never allocates.
+ * 2. Built with -DEXCEPTION_POOL, the program provides its own __cxa_allocate_exception and __cxa_free_exception.
+ *    Threads that call ExceptionPool::reserve() get a private pool of fixed-size blocks, allocated once, from which
+ *    their exception objects are carved; other threads, and objects too large for a block, still use malloc. A block
+ *    may be freed by another thread (an exception_ptr can be rethrown anywhere), so such frees are pushed onto a
+ *    lock-free list that the owning thread reclaims. Pools of threads that have exited are kept for reuse, because
+ *    blocks may still be in flight.
+ *
+ * Replacing the runtime's allocation functions depends on the layout of the runtime's private exception header, so
+ * the pool is only compiled for libstdc++ on 64-bit targets, where that header is 128 bytes.
+*/
+class exception
+{
+    public:
+        explicit exception(std::string_view message = "exception") noexcept
+        {
+            const std::size_t length = std::min(message.size(), sizeof(text) - 1);
+            std::memcpy(text, message.data(), length);
+            text[length] = '\0';
+        }
+
+        virtual ~exception() = default;
+
+        virtual const char* what() const noexcept { return text; }
+
+    private:
+        char text[112];
+};
+
+class runtime_error: public exception
+{
+    public:
+        using exception::exception;
+};
+
+class Validation_error: public runtime_error
+{
+    public:
+        using runtime_error::runtime_error;
+};
+
+
+#if defined(EXCEPTION_POOL) && defined(__GLIBCXX__) && UINTPTR_MAX == UINT64_MAX
+
+class ExceptionPool
+{
+    public:
+        static constexpr std::size_t runtimeHeaderSize = 128;   // sizeof(__cxa_refcounted_exception) in libstdc++
+        static constexpr std::size_t blockSize = 512;           // Our header + runtime header + exception object
+        static constexpr std::size_t blocksPerThread = 64;
+
+        // Gives the calling thread a pool; until it is called, the thread's exceptions come from malloc
+        static void reserve()
+        {
+            if (current == nullptr)
+            {
+                current = adopt();
+            }
+        }
+
+        static void* allocate(std::size_t thrownSize) noexcept
+        {
+            Block* block = nullptr;
+
+            if (current != nullptr && sizeof(Block) + runtimeHeaderSize + thrownSize <= blockSize)
+            {
+                block = current->take();
+            }
+
+            if (block == nullptr)
+            {
+                block = static_cast<Block*>(std::malloc(sizeof(Block) + runtimeHeaderSize + thrownSize));
+
+                if (block == nullptr)
+                {
+                    std::terminate();
+                }
+
+                block->owner = nullptr;
+            }
+
+            // The runtime expects its header to start zeroed
+            std::byte* header = reinterpret_cast<std::byte*>(block + 1);
+            std::memset(header, 0, runtimeHeaderSize);
+
+            return header + runtimeHeaderSize;
+        }
+
+        static void free(void* thrownObject) noexcept
+        {
+            Block* block = reinterpret_cast<Block*>(static_cast<std::byte*>(thrownObject) - runtimeHeaderSize) - 1;
+
+            if (block->owner == nullptr)
+            {
+                std::free(block);
+            }
+            else if (block->owner == current)
+            {
+                block->next = current->local;
+                current->local = block;
+            }
+            else
+            {
+                block->owner->pushRemote(block);
+            }
+        }
+
+    private:
+        struct alignas(16) Block
+        {
+            ExceptionPool* owner;   // Null for blocks that came from malloc
+            Block* next;
+        };
+
+        Block* local = nullptr;                     // Free blocks, touched only by the owning thread
+        std::atomic<Block*> remote { nullptr };     // Free blocks returned by other threads
+        ExceptionPool* nextOrphan = nullptr;
+
+        static thread_local ExceptionPool* current;
+        static inline std::mutex orphanMutex;
+        static inline ExceptionPool* orphans = nullptr;
+
+        ExceptionPool()
+        {
+            std::byte* storage = static_cast<std::byte*>(::operator new(blockSize * blocksPerThread,
+                                                                          std::align_val_t { alignof(Block) }));
+
+            for (std::size_t i = 0; i < blocksPerThread; ++i)
+            {
+                Block* block = reinterpret_cast<Block*>(storage + i * blockSize);
+                block->owner = this;
+                block->next = local;
+                local = block;
+            }
+        }
+
+        Block* take() noexcept
+        {
+            if (local == nullptr)
+            {
+                local = remote.exchange(nullptr, std::memory_order_acquire);
+            }
+
+            Block* block = local;
+
+            if (block != nullptr)
+            {
+                local = block->next;
+            }
+
+            return block;
+        }
+
+        void pushRemote(Block* block) noexcept
+        {
+            block->next = remote.load(std::memory_order_relaxed);
+
+            while (!remote.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                                 std::memory_order_relaxed)) { }
+        }
+
+        // Reuses the pool of a thread that has exited, or makes a new one
+        static ExceptionPool* adopt()
+        {
+            static thread_local Releaser releaser;
+
+            std::lock_guard<std::mutex> lock { orphanMutex };
+
+            if (orphans != nullptr)
+            {
+                ExceptionPool* pool = orphans;
+                orphans = pool->nextOrphan;
+
+                // Blocks freed by the old thread after it exited are still on the remote list
+                return pool;
+            }
+
+            return new ExceptionPool;
+        }
+
+        // Hands the pool back when its thread exits; pools are never deleted, since blocks may still be in flight
+        struct Releaser
+        {
+            ~Releaser()
+            {
+                std::lock_guard<std::mutex> lock { orphanMutex };
+
+                current->nextOrphan = orphans;
+                orphans = current;
+                current = nullptr;
+            }
+        };
+};
+
+thread_local ExceptionPool* ExceptionPool::current = nullptr;
+
+extern "C" void* __cxa_allocate_exception(std::size_t thrownSize) noexcept
+{
+    return ExceptionPool::allocate(thrownSize);
+}
+
+extern "C" void __cxa_free_exception(void* thrownObject) noexcept
+{
+    ExceptionPool::free(thrownObject);
+}
+
+#endif
+
+
+/**
+ * Benchmark:
+ * Runs a throw storm on 1, 2, 4 and more threads, each thread throwing and catching Validation_error in a loop, and
+ * reports throughput with and without per-thread pools. Build with -DEXCEPTION_POOL for the pooled figures; without
+ * it, both runs use the runtime's own allocation.
+*/
+int main()
+{
+    const long throwsPerThread = 100000;
+    const unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+    for (bool pooled : { false, true })
+    {
+        for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            std::atomic<long> caught { 0 };
+            std::vector<std::thread> workers;
+            auto begin = std::chrono::steady_clock::now();
+
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&caught, pooled] {
+                #if defined(EXCEPTION_POOL) && defined(__GLIBCXX__) && UINTPTR_MAX == UINT64_MAX
+                    if (pooled)
+                    {
+                        ExceptionPool::reserve();
+                    }
+                #endif
+
+                    long count = 0;
+
+                    for (long i = 0; i < throwsPerThread; ++i)
+                    {
+                        try
+                        {
+                            throw Validation_error("validation failed");
+                        }
+                        catch (const runtime_error& e)
+                        {
+                            count += e.what()[0] == 'v';
+                        }
+                    }
+
+                    caught += count;
+                });
+            }
+
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+
+            auto end = std::chrono::steady_clock::now();
+
+            std::cout << (pooled ? "pooled, " : "malloc, ") << std::setw(2) << threads << " threads: "
+                      << caught / std::chrono::duration<double>(end - begin).count() / 1e6 << " million throws/s\n";
+        }
+    }
+
+    return 0;
+}
@@ -1,5 +1,15 @@
+#include <chrono>
+#include <cstdint>
+#include <expected>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 /**
  * Catch exceptions by reference.
 */
@@ -77,4 +87,236 @@ void doSomething()
 /**
  * 3. Catching exceptions by reference will solve all the problems above.
  *    So you should always catch exceptions by reference.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Reporting Errors Without Exceptions:
+ * Catching by reference removes the copying and slicing, but not the cost of the throw itself (Item 15). When a
+ * validation failure is an everyday event rather than an exceptional one, the failure can be returned instead, as a
+ * std::expected<T, Error> (C++23) holding either the result or an Error.
+ *
+ * Error is kept small so that returning it is as cheap as returning an int: an error code and a pointer to an
+ * interned message. Interning means each distinct message is stored once for the life of the program, so building an
+ * Error for a message that has been seen before allocates nothing, and copying one never does. Interning takes a lock,
+ * so an Error whose message never changes is best built once, as a function-local static, and then just returned.
+ *
+ * TRY and TRY_ASSIGN propagate an error to the caller in one line, which is what the exception mechanism does
+ * implicitly. At the boundary of an API whose callers expect exceptions, valueOrThrow turns an Error back into the
+ * matching class of the exception hierarchy.
+*/
+enum class ErrorCode : std::uint16_t
+{
+    validation_failed,
+    out_of_range,
+    unknown
+};
+
+
+class Error
+{
+    public:
+        Error(ErrorCode code, std::string_view message) : errorCode { code }, text { intern(message) } { }
+
+        ErrorCode code() const { return errorCode; }
+        const char* message() const { return text; }
+
+    private:
+        ErrorCode errorCode;
+        const char* text;
+
+        // Returns a copy of message that lives as long as the program; equal messages share one copy
+        static const char* intern(std::string_view message)
+        {
+            static std::mutex mutex;
+            static std::unordered_set<std::string> messages;
+
+            std::lock_guard<std::mutex> lock { mutex };
+
+            return messages.emplace(message).first->c_str();
+        }
+};
+
+
+template<class T>
+using Expected = std::expected<T, Error>;
+
+
+// Evaluates an Expected<void>; if it holds an error, returns that error from the enclosing function
+#define TRY(expression)                                         \
+    do                                                          \
+    {                                                           \
+        if (auto result = (expression); !result)                \
+        {                                                       \
+            return std::unexpected(std::move(result).error());  \
+        }                                                       \
+    } while (false)
+
+// Declares variable and initializes it with the value of an Expected<T>, or returns the error from the enclosing function
+#define TRY_ASSIGN(variable, expression)                        \
+    auto variable##Result = (expression);                       \
+    if (!variable##Result)                                      \
+    {                                                           \
+        return std::unexpected(std::move(variable##Result).error()); \
+    }                                                           \
+    auto variable = std::move(*variable##Result)
+
+
+class Validation_error: public std::runtime_error
+{
+    public:
+        using std::runtime_error::runtime_error;
+};
+
+
+// Converts an Error into the exception that callers of an exception-based API expect
+[[noreturn]] inline void throwError(const Error& error)
+{
+    switch (error.code())
+    {
+        case ErrorCode::validation_failed: throw Validation_error(error.message());
+        case ErrorCode::out_of_range: throw std::out_of_range(error.message());
+        default: throw std::runtime_error(error.message());
+    }
+}
+
+template<class T>
+T valueOrThrow(Expected<T> result)
+{
+    if (!result)
+    {
+        throwError(result.error());
+    }
+
+    if constexpr (!std::is_void_v<T>)
+    {
+        return std::move(*result);
+    }
+}
+
+
+// someFunction and doSomething, reporting failure through their return values
+Expected<void> checkInput(int input)
+{
+    if (input < 0)
+    {
+        static const Error negative { ErrorCode::out_of_range, "input is negative" };
+
+        return std::unexpected(negative);
+    }
+
+    return {};
+}
+
+Expected<int> someCheckedFunction(int input)
+{
+    if (input % 7 == 0)     // A validation test fails
+    {
+        static const Error multipleOfSeven { ErrorCode::validation_failed, "input is a multiple of 7" };
+
+        return std::unexpected(multipleOfSeven);
+    }
+
+    return input * 2;
+}
+
+Expected<int> doSomethingChecked(int input)
+{
+    TRY(checkInput(input));
+    TRY_ASSIGN(value, someCheckedFunction(input));
+
+    return value + 1;
+}
+
+// At an API boundary that promises exceptions
+int doSomethingOrThrow(int input)
+{
+    return valueOrThrow(doSomethingChecked(input));
+}
+
+
+/**
+ * Benchmark:
+ * Calls the throwing and the returning versions of a two-level validation at failure rates of 0%, 1% and 50%, each
+ * through a few frames holding objects with destructors, as real code would.
+*/
+[[gnu::noinline]] int validateThrowing(int input, int failEvery)
+{
+    std::string context = "validating";
+
+    if (failEvery != 0 && input % failEvery == 0)
+    {
+        throw Validation_error("validation failed");
+    }
+
+    return input + static_cast<int>(context.size());
+}
+
+[[gnu::noinline]] int processThrowing(int input, int failEvery)
+{
+    std::vector<int> scratch { input };
+
+    return validateThrowing(scratch.front(), failEvery) * 2;
+}
+
+[[gnu::noinline]] Expected<int> validateReturning(int input, int failEvery)
+{
+    std::string context = "validating";
+
+    if (failEvery != 0 && input % failEvery == 0)
+    {
+        static const Error failed { ErrorCode::validation_failed, "validation failed" };
+
+        return std::unexpected(failed);
+    }
+
+    return input + static_cast<int>(context.size());
+}
+
+[[gnu::noinline]] Expected<int> processReturning(int input, int failEvery)
+{
+    std::vector<int> scratch { input };
+    TRY_ASSIGN(value, validateReturning(scratch.front(), failEvery));
+
+    return value * 2;
+}
+
+int main()
+{
+    const int calls = 1000000;
+
+    // failEvery of 0 means never fail; 100 is 1% and 2 is 50%
+    for (int failEvery : { 0, 100, 2 })
+    {
+        long sum = 0;
+        auto begin = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < calls; ++i)
+        {
+            try
+            {
+                sum += processThrowing(i, failEvery);
+            }
+            catch (const Validation_error&)
+            {
+                --sum;
+            }
+        }
+
+        auto middle = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < calls; ++i)
+        {
+            Expected<int> result = processReturning(i, failEvery);
+            sum += result ? *result : -1;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << "failure rate " << (failEvery == 0 ? 0 : 100 / failEvery) << "%: exceptions "
+                  << std::chrono::duration<double, std::nano>(middle - begin).count() / calls << " ns/call, expected "
+                  << std::chrono::duration<double, std::nano>(end - middle).count() / calls << " ns/call ("
+                  << sum << ")\n";
+    }
+
+    return 0;
+}
@@ -1,3 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 /**
  * Understand the costs of exception handling.
 */
@@ -19,4 +28,237 @@
  * of magnitude slower.
  *
  * The conclusion is: avoid using exception handling whenever possible.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Measuring the Costs:
+ * The figures above are rules of thumb from older compilers, and modern "zero-cost" exception implementations move
+ * the cost around rather than removing it: entering a try block is nearly free, but a throw has to allocate the
+ * exception object, walk the unwind tables and run every destructor on the way. The following benchmark measures
+ * these costs on the toolchain at hand:
+ *
+ * 1. Throw/catch latency as a function of how many frames lie between the throw and the catch.
+ * 2. The cost of a loop whose iterations fail (throw) at 0%, 1% and 50% rates, against the same loop reporting
+ *    failure with a return code.
+ * 3. Catch by value, by reference and by pointer (Items 12 and 13), with the Widget and Validation_error types.
+ * 4. Throughput of throw/catch when several threads throw at once. Some unwinders take a global lock to find the
+ *    unwind tables, so this may not scale with the number of threads.
+ * 5. Binary size with and without exception support. SIZE_ONLY compiles just the return-code workload, so both builds
+ *    contain the same source and differ only in exception support. Build it twice and compare the output of "size":
+ *
+ *        g++ -O2 -DSIZE_ONLY "Item 15.cpp" -o with_exceptions
+ *        g++ -O2 -DSIZE_ONLY -fno-exceptions "Item 15.cpp" -o without_exceptions
+*/
+class Widget
+{
+    public:
+        explicit Widget(std::string name) : name { std::move(name) } { }
+
+        const std::string& what() const { return name; }
+
+    private:
+        std::string name;   // Gives copies a real cost, like most exception objects that carry a message
+};
+
+class Validation_error: public std::runtime_error
+{
+    public:
+        using std::runtime_error::runtime_error;
+};
+
+
+// Keeps the compiler from discarding results
+volatile int sink;
+
+// A function that does some work with objects needing destruction, so that unwinding has something to do
+[[gnu::noinline]] int parse(int value, std::string& scratch)
+{
+    std::string local = "value ";
+    local += static_cast<char>('0' + value % 10);
+    scratch = local;
+
+    return static_cast<int>(local.size());
+}
+
+// Return-code version: negative means failure
+[[gnu::noinline]] int validateByCode(int value, int failEvery)
+{
+    std::string scratch;
+
+    if (failEvery != 0 && value % failEvery == 0)
+    {
+        return -1;
+    }
+
+    return parse(value, scratch);
+}
+
+template<class Operation>
+double nanosecondsPer(long iterations, Operation operation)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < iterations; ++i)
+    {
+        operation(i);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+
+#if defined(__cpp_exceptions) && !defined(SIZE_ONLY)
+
+[[gnu::noinline]] int validateByThrow(int value, int failEvery)
+{
+    std::string scratch;
+
+    if (failEvery != 0 && value % failEvery == 0)
+    {
+        throw Validation_error("validation failed");
+    }
+
+    return parse(value, scratch);
+}
+
+// Recurses depth frames, each holding an object with a destructor, then throws
+[[gnu::noinline]] int throwAtDepth(int depth)
+{
+    std::string frame = "frame";
+
+    if (depth == 0)
+    {
+        throw Validation_error("deep failure");
+    }
+
+    return throwAtDepth(depth - 1) + static_cast<int>(frame.size());
+}
+
+void measureDepth()
+{
+    for (int depth : { 0, 10, 100 })
+    {
+        const double ns = nanosecondsPer(20000, [depth](long) {
+            try
+            {
+                sink = throwAtDepth(depth);
+            }
+            catch (const Validation_error&)
+            {
+                sink = 0;
+            }
+        });
+
+        std::cout << "throw through " << std::setw(3) << depth << " frames: " << ns << " ns\n";
+    }
+}
+
+void measureFailureRate()
+{
+    // failEvery of 0 means never fail; 100 is 1% and 2 is 50%
+    for (int failEvery : { 0, 100, 2 })
+    {
+        const double byCode = nanosecondsPer(1000000, [failEvery](long i) {
+            sink = validateByCode(static_cast<int>(i), failEvery);
+        });
+
+        const double byThrow = nanosecondsPer(1000000, [failEvery](long i) {
+            try
+            {
+                sink = validateByThrow(static_cast<int>(i), failEvery);
+            }
+            catch (const Validation_error&)
+            {
+                sink = -1;
+            }
+        });
+
+        std::cout << "failure rate " << (failEvery == 0 ? 0 : 100 / failEvery) << "%: return code " << byCode
+                  << " ns, exception " << byThrow << " ns\n";
+    }
+}
+
+void measureCatchForms()
+{
+    const long iterations = 200000;
+    const std::string longName(64, 'w');    // Too long for the small string optimization, so copies allocate
+
+    std::cout << "catch Widget by value:          " << nanosecondsPer(iterations, [&](long) {
+        try { throw Widget(longName); } catch (Widget w) { sink = static_cast<int>(w.what().size()); }
+    }) << " ns\n";
+
+    std::cout << "catch Widget by reference:      " << nanosecondsPer(iterations, [&](long) {
+        try { throw Widget(longName); } catch (const Widget& w) { sink = static_cast<int>(w.what().size()); }
+    }) << " ns\n";
+
+    std::cout << "catch Widget by pointer:        " << nanosecondsPer(iterations, [&](long) {
+        try { throw new Widget(longName); } catch (Widget* w) { sink = static_cast<int>(w->what().size()); delete w; }
+    }) << " ns\n";
+
+    // By value through the base class: copies, and slices off Validation_error (Item 13). That is what is being
+    // measured, so the warning about it is turned off here.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcatch-value"
+    std::cout << "catch Validation_error by value: " << nanosecondsPer(iterations, [&](long) {
+        try { throw Validation_error(longName); } catch (std::runtime_error e) { sink = e.what()[0]; }
+    }) << " ns\n";
+#pragma GCC diagnostic pop
+
+    std::cout << "catch Validation_error by ref:   " << nanosecondsPer(iterations, [&](long) {
+        try { throw Validation_error(longName); } catch (const std::runtime_error& e) { sink = e.what()[0]; }
+    }) << " ns\n";
+}
+
+void measureThreads()
+{
+    const long throwsPerThread = 100000;
+    const unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([] {
+                for (long i = 0; i < throwsPerThread; ++i)
+                {
+                    try { sink = throwAtDepth(2); } catch (const Validation_error&) { sink = 0; }
+                }
+            });
+        }
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(end - begin).count();
+
+        std::cout << std::setw(2) << threads << " threads: " << throwsPerThread * threads / seconds / 1e6
+                  << " million throws/s\n";
+    }
+}
+
+#endif
+
+
+int main()
+{
+#if defined(__cpp_exceptions) && !defined(SIZE_ONLY)
+    measureDepth();
+    measureFailureRate();
+    measureCatchForms();
+    measureThreads();
+#else
+    std::cout << "return codes only: " << nanosecondsPer(1000000, [](long i) {
+        sink = validateByCode(static_cast<int>(i), 100);
+    }) << " ns\n";
+#endif
+
+    return 0;
+}
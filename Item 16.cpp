@@ -1,3 +1,35 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#ifdef __linux__
+    #include <cxxabi.h>
+    #include <dlfcn.h>
+    #include <pthread.h>
+    #include <sys/time.h>
+    #include <ucontext.h>
+#endif
 /**
  * Remember the 80-20 rule.
 */
@@ -17,4 +49,724 @@
  * It's important to use representative data sets when profiling to avoid optimizing for atypical usage scenarios.
  * By profiling with a variety of representative data, programmers can fine-tune their software to better meet the needs
  * of its primary users.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Instrumenting the Code:
+ * A profiler can only report what it can see, and when the question is "how long does this operation take, and where
+ * inside it does the time go", the simplest profiler is one built into the program. PROFILE_SCOPE(name) times the
+ * enclosing scope:
+ *
+ * 1. The start and end are read from the time-stamp counter (rdtsc) on x86, and from the steady clock elsewhere.
+ * 2. Each thread appends its events to its own fixed-size ring buffer, so recording takes no lock and shares no
+ *    cache line with other threads. The buffer publishes its head with a release store, so an exporter on another
+ *    thread can read every completed event without stopping the program, and drain() hands the events to a callback
+ *    and frees their space, so a long run can be exported in pieces. When a buffer is full, further events are counted
+ *    and dropped rather than allocating, and summarize() and writeChromeTrace() report how many were lost.
+ * 3. Each event records its nesting depth, which lets summarize() rebuild the call hierarchy and report total and self
+ *    time per call path, and writeChromeTrace() write the events in the Chrome trace JSON format, which
+ *    chrome://tracing and Perfetto display as a timeline.
+ *
+ * Recording costs two counter reads and a store, well under 20 ns per scope on bare metal; the benchmark below measures
+ * it, and virtual machines that trap rdtsc can make it several times slower. Without -DENABLE_PROFILING,
+ * PROFILE_SCOPE expands to nothing at all.
+*/
+class Profiler
+{
+    public:
+        using Ticks = std::uint64_t;
+
+        struct Event
+        {
+            const char* name;       // Must be a string literal or otherwise outlive the profiler
+            Ticks start;
+            Ticks end;
+            std::uint32_t depth;
+        };
+
+        static Ticks now()
+        {
+        #if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+        #else
+            return static_cast<Ticks>(std::chrono::steady_clock::now().time_since_epoch().count());
+        #endif
+        }
+
+        static void record(const char* name, Ticks start, Ticks end, std::uint32_t depth)
+        {
+            ThreadBuffer& buffer = threadBuffer();
+            const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+            if (head - buffer.tail.load(std::memory_order_acquire) == capacity)
+            {
+                buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            buffer.events[head % capacity] = { name, start, end, depth };
+            buffer.head.store(head + 1, std::memory_order_release);
+        }
+
+        static std::uint32_t& depth()
+        {
+            static thread_local std::uint32_t current = 0;
+
+            return current;
+        }
+
+        // Aggregated time for one call path, e.g. "frame/update/findCubicleNumber"
+        struct Summary
+        {
+            std::string path;
+            std::uint64_t calls = 0;
+            double totalNanoseconds = 0;
+            double selfNanoseconds = 0;
+        };
+
+        static std::vector<Summary> summarize();
+        static void writeChromeTrace(std::ostream& os);
+
+        // Calls f(threadId, events) with the events each thread has completed, then frees their space
+        template<class Function>
+        static void drain(Function f)
+        {
+            forEachThread(f, true);
+        }
+
+        static void reset()
+        {
+            drain([](std::uint32_t, std::span<const Event>) { });
+        }
+
+        // Events lost because a thread's buffer was full
+        static std::uint64_t droppedEvents()
+        {
+            std::lock_guard<std::mutex> lock { registryMutex };
+            std::uint64_t dropped = 0;
+
+            for (const auto& buffer : registry)
+            {
+                dropped += buffer->dropped.load(std::memory_order_relaxed);
+            }
+
+            return dropped;
+        }
+
+    private:
+        static constexpr std::size_t capacity = 1 << 16;    // Events per thread
+
+        // Events [tail, head) have been recorded and not yet drained
+        struct ThreadBuffer
+        {
+            std::array<Event, capacity> events;
+            std::atomic<std::uint64_t> head { 0 };                  // Written only by the owning thread
+            alignas(64) std::atomic<std::uint64_t> tail { 0 };      // Written only by drain(), under registryMutex
+            std::atomic<std::uint64_t> dropped { 0 };
+            std::uint32_t threadId;
+        };
+
+        static inline std::mutex registryMutex;
+        static inline std::vector<std::unique_ptr<ThreadBuffer>> registry;   // Buffers outlive their threads
+
+        // Registers a buffer the first time a thread records; this is the only time recording takes a lock
+        static ThreadBuffer& threadBuffer()
+        {
+            static thread_local ThreadBuffer* buffer = [] {
+                std::lock_guard<std::mutex> lock { registryMutex };
+
+                registry.push_back(std::make_unique<ThreadBuffer>());
+                registry.back()->threadId = static_cast<std::uint32_t>(registry.size());
+
+                return registry.back().get();
+            }();
+
+            return *buffer;
+        }
+
+        // Calls f(threadId, events) with the events each thread has completed so far, and frees them if consume is set
+        template<class Function>
+        static void forEachThread(Function f, bool consume = false)
+        {
+            std::lock_guard<std::mutex> lock { registryMutex };
+            std::vector<Event> events;
+
+            for (const auto& buffer : registry)
+            {
+                const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+                const std::uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+
+                // The owning thread only writes outside [tail, head), so these slots are stable while they are copied
+                events.clear();
+
+                for (std::uint64_t i = tail; i != head; ++i)
+                {
+                    events.push_back(buffer->events[i % capacity]);
+                }
+
+                f(buffer->threadId, std::span<const Event>(events));
+
+                if (consume)
+                {
+                    buffer->tail.store(head, std::memory_order_release);
+                }
+            }
+        }
+
+        static void writeJsonString(std::ostream& os, const char* text);
+
+        // Nanoseconds per tick, measured once against the steady clock
+        static double nanosecondsPerTick()
+        {
+        #if defined(__x86_64__) || defined(__i386__)
+            static const double ratio = [] {
+                auto wallStart = std::chrono::steady_clock::now();
+                Ticks tickStart = now();
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                auto wallEnd = std::chrono::steady_clock::now();
+                Ticks tickEnd = now();
+
+                return std::chrono::duration<double, std::nano>(wallEnd - wallStart).count() / double(tickEnd - tickStart);
+            }();
+
+            return ratio;
+        #else
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+        #endif
+        }
+};
+
+
+// Times the scope it is declared in
+class ScopeTimer
+{
+    public:
+        explicit ScopeTimer(const char* name) : name { name }, depth { Profiler::depth()++ }, start { Profiler::now() } { }
+
+        ~ScopeTimer()
+        {
+            const Profiler::Ticks end = Profiler::now();
+            --Profiler::depth();
+            Profiler::record(name, start, end, depth);
+        }
+
+        ScopeTimer(const ScopeTimer&) = delete;
+        ScopeTimer& operator = (const ScopeTimer&) = delete;
+
+    private:
+        const char* name;
+        std::uint32_t depth;
+        Profiler::Ticks start;
+};
+
+
+#define PROFILE_CONCATENATE_DETAIL(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_DETAIL(a, b)
+
+#ifdef ENABLE_PROFILING
+    #define PROFILE_SCOPE(name) ScopeTimer PROFILE_CONCATENATE(profileScope, __LINE__) { name }
+#else
+    #define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+
+std::vector<Profiler::Summary> Profiler::summarize()
+{
+    const double scale = nanosecondsPerTick();
+    std::map<std::string, Summary> byPath;
+
+    forEachThread([&](std::uint32_t, std::span<const Event> completed) {
+        // Events are recorded as scopes end, so children come before their parents. Sorting by start time, outermost
+        // first, puts every parent before its children, and a stack of open scopes then gives each event its path.
+        std::vector<Event> events(completed.begin(), completed.end());
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+            return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+        });
+
+        std::vector<std::pair<const Event*, Summary*>> open;
+
+        for (const Event& event : events)
+        {
+            while (!open.empty() && open.back().first->depth >= event.depth)
+            {
+                open.pop_back();
+            }
+
+            std::string path = open.empty() ? event.name : open.back().second->path + '/' + event.name;
+            Summary& summary = byPath[path];
+            const double nanoseconds = double(event.end - event.start) * scale;
+
+            summary.path = std::move(path);
+            ++summary.calls;
+            summary.totalNanoseconds += nanoseconds;
+            summary.selfNanoseconds += nanoseconds;
+
+            if (!open.empty())
+            {
+                open.back().second->selfNanoseconds -= nanoseconds;
+            }
+
+            open.emplace_back(&event, &summary);
+        }
+    });
+
+    std::vector<Summary> summaries;
+
+    for (auto& entry : byPath)
+    {
+        summaries.push_back(std::move(entry.second));
+    }
+
+    std::sort(summaries.begin(), summaries.end(),
+              [](const Summary& a, const Summary& b) { return a.totalNanoseconds > b.totalNanoseconds; });
+
+    // Listed last, so that the paths above are not read as complete when they aren't
+    if (const std::uint64_t dropped = droppedEvents(); dropped != 0)
+    {
+        summaries.push_back({ "[dropped events]", dropped, 0, 0 });
+    }
+
+    return summaries;
+}
+
+
+void Profiler::writeChromeTrace(std::ostream& os)
+{
+    const double scale = nanosecondsPerTick() / 1000;   // Chrome traces are in microseconds
+    Ticks origin = std::numeric_limits<Ticks>::max();
+
+    forEachThread([&](std::uint32_t, std::span<const Event> events) {
+        for (const Event& event : events)
+        {
+            origin = std::min(origin, event.start);
+        }
+    });
+
+    os << "{\"otherData\":{\"droppedEvents\":" << droppedEvents() << "},\"traceEvents\":[";
+    bool first = true;
+
+    forEachThread([&](std::uint32_t threadId, std::span<const Event> events) {
+        for (const Event& event : events)
+        {
+            os << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(os, event.name);
+            os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId << ",\"ts\":" << double(event.start - origin) * scale
+               << ",\"dur\":" << double(event.end - event.start) * scale << '}';
+            first = false;
+        }
+    });
+
+    os << "\n]}\n";
+}
+
+
+void Profiler::writeJsonString(std::ostream& os, const char* text)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    os << '"';
+
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+        const auto byte = static_cast<unsigned char>(*c);
+
+        if (byte == '"' || byte == '\\')
+        {
+            os << '\\' << *c;
+        }
+        else if (byte < 0x20)
+        {
+            os << "\\u00" << hex[byte >> 4] << hex[byte & 0xf];
+        }
+        else
+        {
+            os << *c;
+        }
+    }
+
+    os << '"';
+}
+
+
+// Usage
+void update()
+{
+    PROFILE_SCOPE("update");
+
+    /* ... */
+}
+
+void frame()
+{
+    PROFILE_SCOPE("frame");
+
+    update();
+}
+
+void reportProfile()
+{
+    for (const Profiler::Summary& s : Profiler::summarize())
+    {
+        std::cout << s.path << ": " << s.calls << " calls, " << s.totalNanoseconds << " ns total, "
+                  << s.selfNanoseconds << " ns self\n";
+    }
+
+    std::ofstream trace { "trace.json" };
+    Profiler::writeChromeTrace(trace);
+}
+
+
+/**
+ * Benchmark:
+ * Times 10^7 scopes that each hold a ScopeTimer, against the same loop without one. The buffer is reset between
+ * rounds of 2^15 scopes, outside the timed part, so no event is dropped. The difference is the cost of one scope.
+*/
+volatile int sink;
+
+int main()
+{
+    constexpr int rounds = 300;
+    constexpr int scopesPerRound = 1 << 15;
+
+    double bare = 0;
+    double timed = 0;
+
+    for (int round = 0; round < rounds; ++round)
+    {
+        auto begin = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < scopesPerRound; ++i)
+        {
+            sink = i;
+        }
+
+        auto middle = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < scopesPerRound; ++i)
+        {
+            ScopeTimer timer { "scope" };
+            sink = i;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        bare += std::chrono::duration<double, std::nano>(middle - begin).count();
+        timed += std::chrono::duration<double, std::nano>(end - middle).count();
+        Profiler::reset();
+    }
+
+    std::cout << "cost per scope: " << (timed - bare) / (double(rounds) * scopesPerRound) << " ns ("
+              << Profiler::droppedEvents() << " events dropped)\n";
+
+    return 0;
+}
+
+
+/**
+ * Sampling the Whole Program:
+ * Scope timers only see the code someone thought to annotate. A sampling profiler sees everything: it interrupts the
+ * program at regular intervals of CPU time and records where each interrupted thread was. Functions that appear in many
+ * samples are where the time goes, whether or not anyone suspected them.
+ *
+ * SamplingProfiler runs inside the process, so it can be started and stopped through its API for a few seconds in a
+ * running production binary:
+ *
+ * 1. start() installs a SIGPROF handler and arms an interval timer that delivers SIGPROF to whichever thread is using
+ *    the CPU when each interval of process CPU time elapses.
+ * 2. The handler walks the interrupted thread's stack by following frame pointers (build with
+ *    -fno-omit-frame-pointer), and copies the return addresses into a preallocated buffer, claiming a slot with an
+ *    atomic increment. The handler takes no locks and allocates nothing, so it is safe in a signal handler.
+ * 3. stop() disarms the timer, waits for handlers still running, and keeps the samples. writeRaw() writes them as
+ *    addresses, together with the process's memory map, for symbolization offline; writeFolded() symbolizes them in
+ *    process with dladdr (link with -rdynamic for useful names) and writes the "folded stacks" format read by
+ *    flamegraph.pl and speedscope: one line per distinct stack, outermost frame first, followed by its sample count.
+ *
+ * Frame-pointer unwinding is cheap and safe in a signal handler, but it is not exact: a small leaf function that sets
+ * up no frame of its own hides its caller, and the chain ends at any library compiled without frame pointers. Code
+ * built without frame pointers may also use the frame pointer register for anything at all, so the handler only
+ * follows a frame pointer that lies between the interrupted stack pointer and the top of the thread's stack, and only
+ * upwards. The stack bounds come from pthread_getattr_np, which is not safe in a signal handler, so each thread caches
+ * them by calling registerThread() once; start() registers the thread that calls it. Samples from threads that never
+ * registered record only the interrupted instruction.
+*/
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+
+class SamplingProfiler
+{
+    public:
+        static constexpr std::size_t maxDepth = 64;
+        static constexpr std::size_t capacity = 1 << 15;    // Samples kept per session
+
+        // Samples per second of CPU time, at most one per microsecond
+        static bool start(int frequency = 999)
+        {
+            if (frequency <= 0 || frequency > 1000000 || running.exchange(true))
+            {
+                return false;
+            }
+
+            registerThread();
+
+            // Allocate before any signal can arrive, since the handler must not allocate
+            if (samples == nullptr)
+            {
+                samples = new Sample[capacity];
+            }
+
+            for (std::size_t i = 0; i < capacity; ++i)
+            {
+                samples[i].ready.store(false, std::memory_order_relaxed);
+            }
+
+            next.store(0, std::memory_order_relaxed);
+
+            struct sigaction action {};
+            action.sa_sigaction = onSignal;
+            action.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigemptyset(&action.sa_mask);
+
+            if (sigaction(SIGPROF, &action, &previousAction) != 0)
+            {
+                running.store(false);
+                return false;
+            }
+
+            const long interval = 1000000 / frequency;
+            itimerval timer { { 0, interval }, { 0, interval } };
+
+            if (setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+            {
+                sigaction(SIGPROF, &previousAction, nullptr);
+                running.store(false);
+                return false;
+            }
+
+            return true;
+        }
+
+        // Lets the handler walk the calling thread's stack; call once in every thread that should be fully sampled
+        static void registerThread()
+        {
+            pthread_attr_t attributes;
+
+            if (pthread_getattr_np(pthread_self(), &attributes) != 0)
+            {
+                return;
+            }
+
+            void* low = nullptr;
+            std::size_t size = 0;
+
+            if (pthread_attr_getstack(&attributes, &low, &size) == 0)
+            {
+                stack.low = reinterpret_cast<std::uintptr_t>(low);
+
+                // The handler treats a nonzero top as the sign that low is set too
+                std::atomic_signal_fence(std::memory_order_release);
+                stack.high = stack.low + size;
+            }
+
+            pthread_attr_destroy(&attributes);
+        }
+
+        static void stop()
+        {
+            if (!running.load())
+            {
+                return;
+            }
+
+            itimerval off {};
+            setitimer(ITIMER_PROF, &off, nullptr);
+
+            // A signal may already be pending; ignore it, then wait for any handler still writing a sample
+            signal(SIGPROF, SIG_IGN);
+
+            while (inFlight.load(std::memory_order_acquire) != 0)
+            {
+                std::this_thread::yield();
+            }
+
+            sigaction(SIGPROF, &previousAction, nullptr);
+            running.store(false);
+        }
+
+        // Addresses, outermost frame last, plus /proc/self/maps, for offline symbolization
+        static void writeRaw(std::ostream& os)
+        {
+            std::ifstream maps { "/proc/self/maps" };
+            os << "--- maps\n" << maps.rdbuf() << "--- samples\n";
+
+            forEachSample([&](const Sample& sample) {
+                for (std::size_t i = 0; i < sample.depth; ++i)
+                {
+                    os << (i == 0 ? "" : " ") << sample.frames[i];
+                }
+
+                os << '\n';
+            });
+        }
+
+        static void writeFolded(std::ostream& os)
+        {
+            std::map<std::string, std::size_t> stacks;
+            std::map<void*, std::string> names;
+
+            forEachSample([&](const Sample& sample) {
+                std::string stack;
+
+                for (std::size_t i = sample.depth; i-- > 0; )
+                {
+                    auto [it, inserted] = names.try_emplace(sample.frames[i]);
+
+                    if (inserted)
+                    {
+                        it->second = symbolize(sample.frames[i]);
+                    }
+
+                    stack += (stack.empty() ? "" : ";") + it->second;
+                }
+
+                ++stacks[stack];
+            });
+
+            for (const auto& [stack, count] : stacks)
+            {
+                os << stack << ' ' << count << '\n';
+            }
+        }
+
+        static std::size_t sampleCount() { return std::min(next.load(), capacity); }
+
+    private:
+        struct Sample
+        {
+            std::atomic<bool> ready { false };
+            std::size_t depth;
+            void* frames[maxDepth];     // Innermost frame first
+        };
+
+        static inline std::atomic<bool> running { false };
+        static inline std::atomic<std::size_t> next { 0 };
+        static inline std::atomic<int> inFlight { 0 };
+        static inline struct sigaction previousAction;
+        static inline Sample* samples = nullptr;     // Allocated by the first start(), never freed
+
+        struct StackBounds
+        {
+            std::uintptr_t low;
+            std::uintptr_t high;
+        };
+
+        // Constant-initialized, so the handler can read it without any initialization taking place
+        static inline thread_local StackBounds stack {};
+
+        static void onSignal(int, siginfo_t*, void* context)
+        {
+            inFlight.fetch_add(1, std::memory_order_acquire);
+
+            const std::size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+
+            if (slot < capacity)
+            {
+                Sample& sample = samples[slot];
+                const ucontext_t* uc = static_cast<const ucontext_t*>(context);
+
+            #if defined(__x86_64__)
+                void* pc = reinterpret_cast<void*>(uc->uc_mcontext.gregs[REG_RIP]);
+                const std::uintptr_t sp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+                std::uintptr_t fp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+            #else
+                void* pc = reinterpret_cast<void*>(uc->uc_mcontext.pc);
+                const std::uintptr_t sp = static_cast<std::uintptr_t>(uc->uc_mcontext.sp);
+                std::uintptr_t fp = static_cast<std::uintptr_t>(uc->uc_mcontext.regs[29]);
+            #endif
+
+                sample.frames[0] = pc;
+                sample.depth = 1;
+
+                const std::uintptr_t top = stack.high;
+                std::atomic_signal_fence(std::memory_order_acquire);
+                const std::uintptr_t bottom = std::max(sp, stack.low);
+
+                // Each frame holds the caller's frame pointer followed by the return address. Only read frames that
+                // lie wholly in the live part of this thread's stack, and only move towards its top, so a frame
+                // pointer register holding anything else ends the walk instead of crashing the program.
+                while (sample.depth < maxDepth && top != 0 && fp % sizeof(void*) == 0 && fp >= bottom
+                       && fp < top && top - fp >= 2 * sizeof(std::uintptr_t))
+                {
+                    const std::uintptr_t* frame = reinterpret_cast<const std::uintptr_t*>(fp);
+                    const std::uintptr_t callerFp = frame[0];
+                    const std::uintptr_t returnAddress = frame[1];
+
+                    if (returnAddress == 0)
+                    {
+                        break;
+                    }
+
+                    sample.frames[sample.depth++] = reinterpret_cast<void*>(returnAddress);
+
+                    if (callerFp <= fp)
+                    {
+                        break;
+                    }
+
+                    fp = callerFp;
+                }
+
+                sample.ready.store(true, std::memory_order_release);
+            }
+
+            inFlight.fetch_sub(1, std::memory_order_release);
+        }
+
+        template<class Function>
+        static void forEachSample(Function f)
+        {
+            for (std::size_t i = 0; i < sampleCount(); ++i)
+            {
+                if (samples[i].ready.load(std::memory_order_acquire))
+                {
+                    f(samples[i]);
+                }
+            }
+        }
+
+        static std::string symbolize(void* address)
+        {
+            Dl_info info;
+
+            if (dladdr(address, &info) != 0 && info.dli_sname != nullptr)
+            {
+                int status = 0;
+                std::unique_ptr<char, decltype(&std::free)> demangled {
+                    abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status), &std::free };
+
+                std::string name = status == 0 ? demangled.get() : info.dli_sname;
+
+                // Semicolons separate frames in the folded format
+                std::replace(name.begin(), name.end(), ';', ':');
+
+                return name;
+            }
+
+            std::ostringstream hex;
+            hex << address;
+
+            return hex.str();
+        }
+};
+
+
+// Usage: sample a running program for five seconds
+void sampleProfile()
+{
+    SamplingProfiler::start();
+    std::this_thread::sleep_for(std::chrono::seconds(5));
+    SamplingProfiler::stop();
+
+    std::ofstream folded { "profile.folded" };
+    SamplingProfiler::writeFolded(folded);       // Then: flamegraph.pl profile.folded > profile.svg
+}
+
+#endif
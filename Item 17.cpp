@@ -104,4 +104,12 @@ class Matrix { };
 
 Matrix a { 1000, 1000 };
 Matrix b { 1000, 1000 };
-Matrix c { 1000, 1000 };
\ No newline at end of file
+Matrix c { 1000, 1000 };
+
+// Whether the sum is computed eagerly or lazily, profiling (Item 16) shows where its cost is actually paid
+void addMatrices()
+{
+    PROFILE_SCOPE("Matrix a + b");
+
+    c = a + b;
+}
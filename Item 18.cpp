@@ -35,6 +35,8 @@ class DataCollection
 */
 int findCubicleNumber(std::string employeeName)
 {
+    PROFILE_SCOPE("findCubicleNumber");     // See Item 16
+
     // Define a static map to hold (employee name, cubicle number)
     // pairs. This map is the local cache.
     using CubicleMap = std::map<std::string, int>;
@@ -52,6 +54,8 @@ int findCubicleNumber(std::string employeeName)
     // number, then add it to the cache
     if (it == cubes.end())
     {
+        PROFILE_SCOPE("findCubicleNumber: database lookup");
+
         int cubicle;   // = The result of looking up employeeName’s cubicle number in the database;
 
         cubes[employeeName] = cubicle; // add the pair (employeeName, cubicle) to the cache
@@ -102,6 +106,8 @@ T& DynArray<T>::operator[](int index)
 
     if (index > /* The current maximum index value */)
     {
+        PROFILE_SCOPE("DynArray: grow");
+
         /* Call new to allocate enough additional memory so that index is valid */
     }
 
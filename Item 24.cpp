@@ -1,3 +1,20 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <typeinfo>
+#include <variant>
+#include <vector>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
 /**
  * Understand the costs of virtual functions, multiple inheritance, virtual base classes, and RTTI.
 */
@@ -15,4 +32,509 @@
  * class. Each object whose class declares virtual functions carries with it a hidden data member that points to the
  * virtual table for that class. This hidden data member — the vptr — is added by compilers at a location in the object
  * known only to the compilers.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Measuring the Costs:
+ * The costs above are easy to describe and hard to guess. The following benchmark measures the per-call cost of each
+ * dispatch strategy, together with the branch misses it causes, so the choice of strategy for a hot loop can be made
+ * with data. Each strategy computes the same value over the same four shapes.
+ *
+ * 1. Virtual call through a single-inheritance base
+ * 2. Virtual call through the second base of a multiply-inherited class (needs a this-pointer adjustment)
+ * 3. Virtual call on a class with a virtual base class
+ * 4. Type switch using dynamic_cast
+ * 5. Type switch comparing typeid
+ * 6. CRTP (static dispatch, so only meaningful for homogeneous arrays)
+ * 7. std::variant and std::visit
+ * 8. A hand-written table of function pointers indexed by a type tag
+ *
+ * Each strategy is run over a homogeneous array (every object has the same dynamic type, so the indirect branch is
+ * perfectly predicted) and over a shuffled heterogeneous one (the branch target changes at random). Branch misses are
+ * read through perf_event_open where it is available; elsewhere, or when the kernel forbids it, they are reported as -1.
+*/
+namespace Single
+{
+    class Shape
+    {
+        public:
+            virtual ~Shape() = default;
+            virtual long area() const = 0;
+    };
+
+    class Square: public Shape
+    {
+        public:
+            explicit Square(int s) : side { s } { }
+            long area() const override { return side * side; }
+
+        private:
+            int side;
+    };
+
+    class Rect: public Shape
+    {
+        public:
+            explicit Rect(int s) : w { s }, h { s + 1 } { }
+            long area() const override { return w * h; }
+
+        private:
+            int w;
+            int h;
+    };
+
+    class Circle: public Shape
+    {
+        public:
+            explicit Circle(int s) : r { s } { }
+            long area() const override { return 3 * r * r; }
+
+        private:
+            int r;
+    };
+
+    class Triangle: public Shape
+    {
+        public:
+            explicit Triangle(int s) : b { s }, h { s + 2 } { }
+            long area() const override { return b * h / 2; }
+
+        private:
+            int b;
+            int h;
+    };
+}
+
+
+namespace Multiple
+{
+    // Shape is the second base, so every call through a Shape* has to adjust "this" back to the full object
+    class Named { public: virtual ~Named() = default; virtual const char* name() const { return "shape"; } };
+    class Shape { public: virtual ~Shape() = default; virtual long area() const = 0; };
+
+    class Square: public Named, public Shape
+    {
+        public:
+            explicit Square(int s) : side { s } { }
+            long area() const override { return side * side; }
+
+        private:
+            int side;
+    };
+
+    class Rect: public Named, public Shape
+    {
+        public:
+            explicit Rect(int s) : w { s }, h { s + 1 } { }
+            long area() const override { return w * h; }
+
+        private:
+            int w;
+            int h;
+    };
+
+    class Circle: public Named, public Shape
+    {
+        public:
+            explicit Circle(int s) : r { s } { }
+            long area() const override { return 3 * r * r; }
+
+        private:
+            int r;
+    };
+
+    class Triangle: public Named, public Shape
+    {
+        public:
+            explicit Triangle(int s) : b { s }, h { s + 2 } { }
+            long area() const override { return b * h / 2; }
+
+        private:
+            int b;
+            int h;
+    };
+}
+
+
+namespace VirtualBase
+{
+    // Every derived class reaches Shape through a virtual base, so the base sub-object is found through the vtbl
+    class Shape { public: virtual ~Shape() = default; virtual long area() const = 0; int scale = 1; };
+
+    class Square: public virtual Shape
+    {
+        public:
+            explicit Square(int s) : side { s } { }
+            long area() const override { return scale * side * side; }
+
+        private:
+            int side;
+    };
+
+    class Rect: public virtual Shape
+    {
+        public:
+            explicit Rect(int s) : w { s }, h { s + 1 } { }
+            long area() const override { return scale * w * h; }
+
+        private:
+            int w;
+            int h;
+    };
+
+    class Circle: public virtual Shape
+    {
+        public:
+            explicit Circle(int s) : r { s } { }
+            long area() const override { return scale * 3 * r * r; }
+
+        private:
+            int r;
+    };
+
+    class Triangle: public virtual Shape
+    {
+        public:
+            explicit Triangle(int s) : b { s }, h { s + 2 } { }
+            long area() const override { return scale * b * h / 2; }
+
+        private:
+            int b;
+            int h;
+    };
+}
+
+
+namespace Crtp
+{
+    template<class Derived>
+    class Shape
+    {
+        public:
+            long area() const { return static_cast<const Derived*>(this)->areaImpl(); }
+    };
+
+    class Square: public Shape<Square>
+    {
+        public:
+            explicit Square(int s) : side { s } { }
+            long areaImpl() const { return side * side; }
+
+        private:
+            int side;
+    };
+}
+
+
+namespace Variant
+{
+    struct Square { int side; long area() const { return side * side; } };
+    struct Rect { int w; int h; long area() const { return w * h; } };
+    struct Circle { int r; long area() const { return 3 * r * r; } };
+    struct Triangle { int b; int h; long area() const { return b * h / 2; } };
+
+    using Shape = std::variant<Square, Rect, Circle, Triangle>;
+}
+
+
+namespace FunctionTable
+{
+    // A type tag plus the data every shape needs; the tag indexes a table of plain function pointers
+    struct Shape
+    {
+        int kind;
+        int a;
+        int b;
+    };
+
+    long squareArea(const Shape& s) { return s.a * s.a; }
+    long rectArea(const Shape& s) { return s.a * s.b; }
+    long circleArea(const Shape& s) { return 3 * s.a * s.a; }
+    long triangleArea(const Shape& s) { return s.a * s.b / 2; }
+
+    using AreaFunction = long (*)(const Shape&);
+
+    constexpr AreaFunction areaTable[] = { squareArea, rectArea, circleArea, triangleArea };
+}
+
+
+// Counts branch misses of the calling thread for the lifetime of a measurement
+class BranchMissCounter
+{
+    public:
+        BranchMissCounter()
+        {
+        #ifdef __linux__
+            perf_event_attr attr {};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        #endif
+        }
+
+        ~BranchMissCounter()
+        {
+        #ifdef __linux__
+            if (fd != -1)
+            {
+                close(fd);
+            }
+        #endif
+        }
+
+        BranchMissCounter(const BranchMissCounter&) = delete;
+        BranchMissCounter& operator = (const BranchMissCounter&) = delete;
+
+        void start()
+        {
+        #ifdef __linux__
+            if (fd != -1)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        #endif
+        }
+
+        // Returns the number of misses since start(), or -1 if the counter is unavailable
+        long long stop()
+        {
+        #ifdef __linux__
+            long long count = -1;
+
+            if (fd != -1)
+            {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+                if (read(fd, &count, sizeof(count)) != sizeof(count))
+                {
+                    count = -1;
+                }
+            }
+
+            return count;
+        #else
+            return -1;
+        #endif
+        }
+
+    private:
+        int fd = -1;
+};
+
+
+const std::size_t OBJECTS = 1 << 16;   // # of objects in each array
+const int PASSES = 100;                // # of passes over each array
+
+// Keeps the compiler from discarding a loop whose result is otherwise unused
+volatile long sink;
+
+template<class Loop>
+void measure(const char* strategy, const char* layout, Loop loop)
+{
+    BranchMissCounter misses;
+    long total = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    misses.start();
+
+    for (int pass = 0; pass < PASSES; ++pass)
+    {
+        total += loop();
+    }
+
+    long long missCount = misses.stop();
+    auto end = std::chrono::steady_clock::now();
+
+    sink = total;
+
+    const double calls = double(OBJECTS) * PASSES;
+    const double nanoseconds = std::chrono::duration<double, std::nano>(end - begin).count();
+
+    std::cout << std::left << std::setw(16) << strategy << std::setw(16) << layout
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << nanoseconds / calls << " ns/call"
+              << std::setw(10) << (missCount < 0 ? -1.0 : missCount / calls) << " misses/call\n";
+}
+
+
+// Builds one object of the given kind (0-3) for a hierarchy whose classes are named Square, Rect, Circle and Triangle
+template<class Base, class Square, class Rect, class Circle, class Triangle>
+std::vector<std::unique_ptr<Base>> makeShapes(const std::vector<int>& kinds)
+{
+    std::vector<std::unique_ptr<Base>> shapes;
+    shapes.reserve(kinds.size());
+
+    for (std::size_t i = 0; i < kinds.size(); ++i)
+    {
+        const int size = static_cast<int>(i % 7) + 1;
+
+        switch (kinds[i])
+        {
+            case 0: shapes.push_back(std::make_unique<Square>(size)); break;
+            case 1: shapes.push_back(std::make_unique<Rect>(size)); break;
+            case 2: shapes.push_back(std::make_unique<Circle>(size)); break;
+            default: shapes.push_back(std::make_unique<Triangle>(size)); break;
+        }
+    }
+
+    return shapes;
+}
+
+
+void runLayout(const char* layout, const std::vector<int>& kinds)
+{
+    using namespace std::string_view_literals;
+    const bool homogeneous = (layout == "homogeneous"sv);
+
+    // 1
+    {
+        auto shapes = makeShapes<Single::Shape, Single::Square, Single::Rect, Single::Circle, Single::Triangle>(kinds);
+
+        measure("single", layout, [&] {
+            long sum = 0;
+            for (const auto& s : shapes) { sum += s->area(); }
+            return sum;
+        });
+
+        // 4
+        measure("dynamic_cast", layout, [&] {
+            long sum = 0;
+            for (const auto& s : shapes)
+            {
+                if (auto p = dynamic_cast<const Single::Square*>(s.get())) { sum += p->area(); }
+                else if (auto p = dynamic_cast<const Single::Rect*>(s.get())) { sum += p->area(); }
+                else if (auto p = dynamic_cast<const Single::Circle*>(s.get())) { sum += p->area(); }
+                else if (auto p = dynamic_cast<const Single::Triangle*>(s.get())) { sum += p->area(); }
+            }
+            return sum;
+        });
+
+        // 5
+        measure("typeid", layout, [&] {
+            long sum = 0;
+            for (const auto& s : shapes)
+            {
+                const std::type_info& type = typeid(*s);
+
+                if (type == typeid(Single::Square)) { sum += static_cast<const Single::Square&>(*s).area(); }
+                else if (type == typeid(Single::Rect)) { sum += static_cast<const Single::Rect&>(*s).area(); }
+                else if (type == typeid(Single::Circle)) { sum += static_cast<const Single::Circle&>(*s).area(); }
+                else { sum += static_cast<const Single::Triangle&>(*s).area(); }
+            }
+            return sum;
+        });
+    }
+
+    // 2
+    {
+        auto shapes = makeShapes<Multiple::Shape, Multiple::Square, Multiple::Rect, Multiple::Circle,
+                                 Multiple::Triangle>(kinds);
+
+        measure("multiple", layout, [&] {
+            long sum = 0;
+            for (const auto& s : shapes) { sum += s->area(); }
+            return sum;
+        });
+    }
+
+    // 3
+    {
+        auto shapes = makeShapes<VirtualBase::Shape, VirtualBase::Square, VirtualBase::Rect, VirtualBase::Circle,
+                                 VirtualBase::Triangle>(kinds);
+
+        measure("virtual base", layout, [&] {
+            long sum = 0;
+            for (const auto& s : shapes) { sum += s->area(); }
+            return sum;
+        });
+    }
+
+    // 6 - CRTP cannot hold different types in one array, so it only has a homogeneous figure
+    if (homogeneous)
+    {
+        std::vector<Crtp::Square> shapes;
+        shapes.reserve(kinds.size());
+
+        for (std::size_t i = 0; i < kinds.size(); ++i)
+        {
+            shapes.emplace_back(static_cast<int>(i % 7) + 1);
+        }
+
+        measure("crtp", layout, [&] {
+            long sum = 0;
+            for (const auto& s : shapes) { sum += s.area(); }
+            return sum;
+        });
+    }
+
+    // 7 and 8
+    {
+        std::vector<Variant::Shape> variants;
+        std::vector<FunctionTable::Shape> tagged;
+        variants.reserve(kinds.size());
+        tagged.reserve(kinds.size());
+
+        for (std::size_t i = 0; i < kinds.size(); ++i)
+        {
+            const int size = static_cast<int>(i % 7) + 1;
+
+            switch (kinds[i])
+            {
+                case 0: variants.emplace_back(Variant::Square { size }); break;
+                case 1: variants.emplace_back(Variant::Rect { size, size + 1 }); break;
+                case 2: variants.emplace_back(Variant::Circle { size }); break;
+                default: variants.emplace_back(Variant::Triangle { size, size + 2 }); break;
+            }
+
+            tagged.push_back({ kinds[i], size, kinds[i] == 1 ? size + 1 : size + 2 });
+        }
+
+        measure("variant", layout, [&] {
+            long sum = 0;
+            for (const auto& v : variants) { sum += std::visit([](const auto& s) { return s.area(); }, v); }
+            return sum;
+        });
+
+        measure("function table", layout, [&] {
+            long sum = 0;
+            for (const auto& s : tagged) { sum += FunctionTable::areaTable[s.kind](s); }
+            return sum;
+        });
+    }
+}
+
+
+int main()
+{
+    // Every object has the same dynamic type
+    std::vector<int> kinds(OBJECTS, 0);
+    runLayout("homogeneous", kinds);
+
+    // All four types, in random order
+    for (std::size_t i = 0; i < kinds.size(); ++i)
+    {
+        kinds[i] = static_cast<int>(i % 4);
+    }
+
+    std::shuffle(kinds.begin(), kinds.end(), std::mt19937 { 24 });
+    runLayout("shuffled", kinds);
+
+    return 0;
+}
+
+
+/**
+ * Reading the Results:
+ * On a homogeneous array all of the strategies are close, because the branch predictor learns the single target and
+ * the vptr loads hit the cache. Shuffling the array is what separates them: virtual calls, dynamic_cast chains and
+ * typeid chains all pay a branch miss on most calls, while variant and function-table dispatch keep the objects
+ * inline and avoid a pointer chase. Multiple inheritance and virtual bases add a few instructions per call, which is
+ * usually lost in the noise next to a miss. If a hot loop is slow, sorting objects by type often pays off more than
+ * changing the dispatch mechanism.
+*/
@@ -1,5 +1,45 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <semaphore>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 /**
  * Virtualizing constructors and non-member functions.
 */
@@ -166,4 +206,1588 @@ inline std::ostream& operator << (std::ostream& s, const NLComponent& c)
  * Complexity with Multiple Arguments:
  * Finally, the article touches on the complexity of making non-member functions act virtually on more than one of
  * their arguments, pointing readers to another item for further details.
-*/
\ No newline at end of file
+*/
+
+/**
+ * Batch Dispatch by Type:
+ * A std::list<NLComponent*> makes every operation chase a pointer to a node, chase another to the component, and then
+ * take an indirect branch whose target depends on a type that changes from one node to the next. When the set of
+ * component types is known, the components can instead be grouped by dynamic type into contiguous per-type arrays,
+ * with a small index recording the logical order of the newsletter.
+ *
+ * Operations that must respect the logical order, such as printAll, walk the index and select the array with a plain
+ * comparison on a type tag; the call itself names the class explicitly, so it is not virtual. Operations that don't
+ * care about order, such as cloneAll or forEachByType, run one tight loop per type with no dispatch at all.
+*/
+class NLComponent
+{
+    public:
+        virtual ~NLComponent() = default;
+
+        virtual NLComponent* clone() const = 0;
+        virtual std::ostream& print(std::ostream& s) const = 0;
+};
+
+
+class TextBlock: public NLComponent
+{
+    public:
+        explicit TextBlock(std::string text) : text { std::move(text) } { }
+
+        virtual TextBlock* clone() const { return new TextBlock(*this); }
+        virtual std::ostream& print(std::ostream& s) const { return s << text << '\n'; }
+
+    private:
+        std::string text;
+};
+
+
+class Graphic: public NLComponent
+{
+    public:
+        Graphic(int width, int height) : width { width }, height { height } { }
+
+        virtual Graphic* clone() const { return new Graphic(*this); }
+        virtual std::ostream& print(std::ostream& s) const { return s << "[graphic " << width << 'x' << height << "]\n"; }
+
+    private:
+        int width;
+        int height;
+};
+
+
+template<class... Components>
+class TypeSortedComponents
+{
+    public:
+        template<class Component>
+        void push_back(Component component)
+        {
+            auto& pool = std::get<std::vector<Component>>(pools);
+            order.push_back({ typeIndex<Component>(), static_cast<std::uint32_t>(pool.size()) });
+            pool.push_back(std::move(component));
+        }
+
+        // Copies a component whose dynamic type is one of Components; returns false for any other type
+        bool append(const NLComponent& component)
+        {
+            return ((typeid(component) == typeid(Components)
+                     ? (push_back(static_cast<const Components&>(component)), true) : false) || ...);
+        }
+
+        std::size_t size() const { return order.size(); }
+
+        // Prints in logical order; the type tag selects the array and the qualified call is resolved statically
+        std::ostream& printAll(std::ostream& s) const
+        {
+            for (const Entry& entry : order)
+            {
+                printEntry(s, entry, std::index_sequence_for<Components...>());
+            }
+
+            return s;
+        }
+
+        // Copying the per-type arrays costs one allocation per type instead of one per component
+        TypeSortedComponents cloneAll() const { return *this; }
+
+        // Visits every component, one contiguous loop per type, ignoring logical order
+        template<class Visitor>
+        void forEachByType(Visitor visitor) const
+        {
+            (forEach(std::get<std::vector<Components>>(pools), visitor), ...);
+        }
+
+    private:
+        struct Entry
+        {
+            std::uint32_t type;     // Position of the component's class in Components
+            std::uint32_t slot;     // Position of the component in that class's array
+        };
+
+        std::tuple<std::vector<Components>...> pools;
+        std::vector<Entry> order;
+
+        template<class Component>
+        static constexpr std::uint32_t typeIndex()
+        {
+            std::uint32_t index = 0;
+            bool found = ((std::is_same_v<Component, Components> ? true : (++index, false)) || ...);
+
+            return found ? index : throw std::logic_error("not a component type of this container");
+        }
+
+        template<std::size_t... Is>
+        void printEntry(std::ostream& s, const Entry& entry, std::index_sequence<Is...>) const
+        {
+            ((entry.type == Is ? (void)std::get<Is>(pools)[entry.slot].Components::print(s) : void()), ...);
+        }
+
+        template<class Component, class Visitor>
+        static void forEach(const std::vector<Component>& pool, Visitor& visitor)
+        {
+            for (const Component& component : pool)
+            {
+                visitor(component);
+            }
+        }
+};
+
+using NewsLetterComponents = TypeSortedComponents<TextBlock, Graphic>;
+
+
+/**
+ * Benchmark:
+ * Builds the same 10^6 randomly mixed components in a std::list<NLComponent*> and in NewsLetterComponents, then times
+ * printing each into a string stream and copying each (clone per node for the list, cloneAll for the batches).
+*/
+const int COMPONENTS = 1000000;
+
+template<class Operation>
+double millisecondsFor(Operation operation)
+{
+    auto begin = std::chrono::steady_clock::now();
+    operation();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+int main()
+{
+    std::list<NLComponent*> list;
+    NewsLetterComponents batches;
+    std::mt19937 random { 25 };
+
+    for (int i = 0; i < COMPONENTS; ++i)
+    {
+        if (random() % 2 == 0)
+        {
+            list.push_back(new TextBlock("text " + std::to_string(i)));
+        }
+        else
+        {
+            list.push_back(new Graphic(i % 640, i % 480));
+        }
+
+        batches.append(*list.back());
+    }
+
+    std::ostringstream listOut;
+    std::ostringstream batchOut;
+
+    std::cout << "print, list:    " << millisecondsFor([&] {
+        for (const NLComponent* c : list) { c->print(listOut); }
+    }) << " ms\n";
+
+    std::cout << "print, batches: " << millisecondsFor([&] { batches.printAll(batchOut); }) << " ms\n";
+
+    std::list<NLComponent*> listCopy;
+    NewsLetterComponents batchCopy;
+
+    std::cout << "clone, list:    " << millisecondsFor([&] {
+        for (const NLComponent* c : list) { listCopy.push_back(c->clone()); }
+    }) << " ms\n";
+
+    std::cout << "clone, batches: " << millisecondsFor([&] { batchCopy = batches.cloneAll(); }) << " ms\n";
+
+    if (listOut.str() != batchOut.str() || listCopy.size() != batchCopy.size())
+    {
+        std::cerr << "batched output differs from the list\n";
+    }
+
+    for (NLComponent* c : list) { delete c; }
+    for (NLComponent* c : listCopy) { delete c; }
+
+    return 0;
+}
+
+
+/**
+ * A Binary Format and a Zero-Copy Reader:
+ * Reading a newsletter through readComponent parses every component and allocates an object for it before anything
+ * can be used. A binary format designed to be read in place avoids both. A newsletter file is a header followed by one
+ * record per component:
+ *
+ *     header:  "NLTR"  version (u16)  flags (u16)  reserved (u32)  component count (u64)
+ *     record:  type tag (u16)  reserved (u16)  payload length (u32)  payload  padding to a multiple of 8 bytes
+ *
+ * A TextBlock's payload is its text. A Graphic's payload is its width and height (u32 each) followed by its pixels.
+ * All integers are little-endian.
+ *
+ * NewsLetterView maps the file into memory and reads it where it lies: opening it checks only the header, iterating
+ * steps from record to record, and TextBlockView and GraphicView point into the mapping. Nothing is copied or
+ * allocated, so opening even a very large archive costs the same as opening a small one, and only the pages actually
+ * visited are ever read from disk. A record that would run past the end of the file is reported as corrupt.
+*/
+static_assert(std::endian::native == std::endian::little, "the newsletter format is little-endian");
+
+enum class ComponentType : std::uint16_t
+{
+    textBlock = 1,
+    graphic = 2
+};
+
+struct NewsLetterHeader
+{
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t flags;
+    std::uint32_t reserved;
+    std::uint64_t count;
+};
+
+struct RecordHeader
+{
+    ComponentType type;
+    std::uint16_t reserved;
+    std::uint32_t length;
+};
+
+constexpr char newsLetterMagic[4] = { 'N', 'L', 'T', 'R' };
+constexpr std::uint16_t newsLetterVersion = 1;
+constexpr std::size_t recordAlignment = 8;
+
+
+// Writes components in the binary format; the count in the header is filled in by finish()
+class NewsLetterWriter
+{
+    public:
+        explicit NewsLetterWriter(std::ostream& out) : out { out }
+        {
+            NewsLetterHeader header {};
+            std::memcpy(header.magic, newsLetterMagic, sizeof(header.magic));
+            header.version = newsLetterVersion;
+
+            start = out.tellp();
+            write(&header, sizeof(header));
+        }
+
+        void addTextBlock(std::string_view text)
+        {
+            writeRecord(ComponentType::textBlock, { reinterpret_cast<const std::byte*>(text.data()), text.size() });
+        }
+
+        void addGraphic(std::uint32_t width, std::uint32_t height, std::span<const std::byte> pixels)
+        {
+            std::vector<std::byte> payload(2 * sizeof(std::uint32_t) + pixels.size());
+            std::memcpy(payload.data(), &width, sizeof(width));
+            std::memcpy(payload.data() + sizeof(width), &height, sizeof(height));
+            std::copy(pixels.begin(), pixels.end(), payload.begin() + 2 * sizeof(std::uint32_t));
+
+            writeRecord(ComponentType::graphic, payload);
+        }
+
+        void finish()
+        {
+            const std::streampos end = out.tellp();
+
+            out.seekp(start + std::streamoff(offsetof(NewsLetterHeader, count)));
+            write(&count, sizeof(count));
+            out.seekp(end);
+        }
+
+    private:
+        std::ostream& out;
+        std::streampos start;
+        std::uint64_t count = 0;
+
+        void write(const void* data, std::size_t size) { out.write(static_cast<const char*>(data), size); }
+
+        void writeRecord(ComponentType type, std::span<const std::byte> payload)
+        {
+            if (payload.size() > std::numeric_limits<std::uint32_t>::max())
+            {
+                throw std::length_error("newsletter component too large");
+            }
+
+            const RecordHeader header { type, 0, static_cast<std::uint32_t>(payload.size()) };
+            const char padding[recordAlignment] = {};
+
+            write(&header, sizeof(header));
+            write(payload.data(), payload.size());
+            write(padding, (recordAlignment - payload.size() % recordAlignment) % recordAlignment);
+
+            ++count;
+        }
+};
+
+
+// A read-only memory mapping of a whole file
+class MappedFile
+{
+    public:
+        explicit MappedFile(const char* path)
+        {
+            const int fd = ::open(path, O_RDONLY);
+
+            if (fd == -1)
+            {
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+
+            struct stat status;
+
+            if (::fstat(fd, &status) == -1)
+            {
+                ::close(fd);
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+
+            size = static_cast<std::size_t>(status.st_size);
+
+            if (size != 0)
+            {
+                void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (mapping == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw std::system_error(errno, std::generic_category(), path);
+                }
+
+                data = static_cast<const std::byte*>(mapping);
+            }
+
+            ::close(fd);    // The mapping keeps the file open
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+            if (data != nullptr)
+            {
+                ::munmap(const_cast<std::byte*>(data), size);
+            }
+        }
+
+        std::span<const std::byte> bytes() const { return { data, size }; }
+
+    private:
+        const std::byte* data = nullptr;
+        std::size_t size = 0;
+};
+
+
+class TextBlockView
+{
+    public:
+        explicit TextBlockView(std::span<const std::byte> payload)
+            : contents { reinterpret_cast<const char*>(payload.data()), payload.size() } { }
+
+        std::string_view text() const { return contents; }
+
+    private:
+        std::string_view contents;
+};
+
+
+class GraphicView
+{
+    public:
+        explicit GraphicView(std::span<const std::byte> payload)
+        {
+            if (payload.size() < 2 * sizeof(std::uint32_t))
+            {
+                throw std::runtime_error("corrupt newsletter: graphic record too short");
+            }
+
+            std::memcpy(&w, payload.data(), sizeof(w));
+            std::memcpy(&h, payload.data() + sizeof(w), sizeof(h));
+            image = payload.subspan(2 * sizeof(std::uint32_t));
+        }
+
+        std::uint32_t width() const { return w; }
+        std::uint32_t height() const { return h; }
+        std::span<const std::byte> pixels() const { return image; }
+
+    private:
+        std::uint32_t w;
+        std::uint32_t h;
+        std::span<const std::byte> image;
+};
+
+
+class ComponentView
+{
+    public:
+        ComponentView(ComponentType type, std::span<const std::byte> payload) : componentType { type }, data { payload } { }
+
+        ComponentType type() const { return componentType; }
+
+        TextBlockView asTextBlock() const { return TextBlockView { data }; }
+        GraphicView asGraphic() const { return GraphicView { data }; }
+
+    private:
+        ComponentType componentType;
+        std::span<const std::byte> data;
+};
+
+
+class NewsLetterView
+{
+    public:
+        class iterator
+        {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = ComponentView;
+                using difference_type = std::ptrdiff_t;
+                using pointer = void;
+                using reference = ComponentView;
+
+                iterator(std::span<const std::byte> file, std::size_t offset) : file { file }, offset { offset } { }
+
+                ComponentView operator * () const
+                {
+                    const RecordHeader header = recordHeader();
+
+                    return { header.type, file.subspan(offset + sizeof(RecordHeader), header.length) };
+                }
+
+                iterator& operator ++ ()
+                {
+                    const std::size_t length = recordHeader().length;
+                    offset += sizeof(RecordHeader) + (length + recordAlignment - 1) / recordAlignment * recordAlignment;
+                    offset = std::min(offset, file.size());
+
+                    return *this;
+                }
+
+                iterator operator ++ (int) { iterator old { *this }; ++*this; return old; }
+
+                bool operator == (const iterator& rhs) const { return offset == rhs.offset; }
+                bool operator != (const iterator& rhs) const { return offset != rhs.offset; }
+
+            private:
+                std::span<const std::byte> file;
+                std::size_t offset;
+
+                // Checks that the record, including its payload, lies inside the file
+                RecordHeader recordHeader() const
+                {
+                    RecordHeader header;
+
+                    if (file.size() - offset < sizeof(header))
+                    {
+                        throw std::runtime_error("corrupt newsletter: truncated record header");
+                    }
+
+                    std::memcpy(&header, file.data() + offset, sizeof(header));
+
+                    if (file.size() - offset - sizeof(header) < header.length)
+                    {
+                        throw std::runtime_error("corrupt newsletter: record runs past end of file");
+                    }
+
+                    return header;
+                }
+        };
+
+        explicit NewsLetterView(const char* path) : file { path }
+        {
+            const std::span<const std::byte> bytes = file.bytes();
+
+            if (bytes.size() < sizeof(header))
+            {
+                throw std::runtime_error("not a newsletter: file too short");
+            }
+
+            std::memcpy(&header, bytes.data(), sizeof(header));
+
+            if (std::memcmp(header.magic, newsLetterMagic, sizeof(header.magic)) != 0)
+            {
+                throw std::runtime_error("not a newsletter: bad magic number");
+            }
+
+            if (header.version != newsLetterVersion)
+            {
+                throw std::runtime_error("unsupported newsletter version");
+            }
+        }
+
+        std::uint64_t size() const { return header.count; }
+
+        iterator begin() const { return { file.bytes(), sizeof(NewsLetterHeader) }; }
+        iterator end() const { return { file.bytes(), file.bytes().size() }; }
+
+    private:
+        MappedFile file;
+        NewsLetterHeader header;
+};
+
+
+// Usage
+void printArchive()
+{
+    NewsLetterView newsLetter { "archive.nltr" };
+
+    for (ComponentView component : newsLetter)
+    {
+        switch (component.type())
+        {
+            case ComponentType::textBlock: std::cout << component.asTextBlock().text() << '\n'; break;
+            case ComponentType::graphic: std::cout << component.asGraphic().width() << 'x'
+                                                   << component.asGraphic().height() << '\n'; break;
+        }
+    }
+}
+
+
+/**
+ * Loading in Parallel:
+ * The while (str) loop around readComponent is strictly sequential: each component is parsed and constructed before
+ * the next is even located. In the binary format above, finding where a record ends only requires reading its length,
+ * which is far cheaper than constructing the component, so loading can be split into a pipeline:
+ *
+ * 1. A reader thread reads the stream in large batches, cutting them at record boundaries.
+ * 2. A pool of workers constructs the TextBlock and Graphic objects for whole batches at a time, in parallel.
+ * 3. The calling thread collects the finished batches and appends them to the result in their original order.
+ *
+ * The queue between the reader and the workers is bounded, and so is the number of batches read but not yet appended
+ * to the result, so neither a slow pool nor one slow batch makes the reader buffer the rest of the stream in memory. A
+ * stream that ends part way through a record, or holds a different number of records than its header says, is
+ * reported as corrupt. If any stage throws, the pipeline shuts down and the exception is rethrown to the caller.
+*/
+template<class T>
+class BoundedQueue
+{
+    public:
+        explicit BoundedQueue(std::size_t capacity) : capacity { capacity } { }
+
+        // Returns false if the queue was closed before there was room
+        bool push(T value)
+        {
+            std::unique_lock<std::mutex> lock { mutex };
+            notFull.wait(lock, [&] { return items.size() < capacity || closed; });
+
+            if (closed)
+            {
+                return false;
+            }
+
+            items.push_back(std::move(value));
+            notEmpty.notify_one();
+
+            return true;
+        }
+
+        // Returns nothing once the queue is closed and empty
+        std::optional<T> pop()
+        {
+            std::unique_lock<std::mutex> lock { mutex };
+            notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+
+            if (items.empty())
+            {
+                return std::nullopt;
+            }
+
+            T value = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+
+            return value;
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> lock { mutex };
+            closed = true;
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::deque<T> items;
+        std::size_t capacity;
+        bool closed = false;
+};
+
+
+class ParallelNewsLetterLoader
+{
+    public:
+        using Components = std::vector<std::unique_ptr<NLComponent>>;
+
+        static Components load(std::istream& str, unsigned threads = std::thread::hardware_concurrency())
+        {
+            const std::uint64_t expected = readHeader(str);
+            threads = std::max(threads, 1u);
+
+            BoundedQueue<Batch> batches { 2 * threads };
+            BoundedQueue<Built> built { 2 * threads };
+            std::counting_semaphore<> inFlight { 4 * static_cast<std::ptrdiff_t>(threads) };     // Read, not yet appended
+            std::exception_ptr failure;
+            std::mutex failureMutex;
+
+            auto fail = [&](std::exception_ptr e) {
+                {
+                    std::lock_guard<std::mutex> lock { failureMutex };
+
+                    if (!failure)
+                    {
+                        failure = e;
+                    }
+                }
+
+                batches.close();
+                built.close();
+            };
+
+            // 1
+            std::thread reader([&] {
+                try
+                {
+                    for (std::uint64_t sequence = 0; ; ++sequence)
+                    {
+                        inFlight.acquire();
+                        Batch batch = readBatch(str, sequence);
+
+                        if (batch.records.empty() || !batches.push(std::move(batch)))
+                        {
+                            break;
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    fail(std::current_exception());
+                }
+
+                batches.close();
+            });
+
+            // 2
+            std::atomic<unsigned> workersLeft { threads };
+            std::vector<std::thread> workers;
+
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&] {
+                    try
+                    {
+                        while (std::optional<Batch> batch = batches.pop())
+                        {
+                            if (!built.push({ batch->sequence, construct(*batch) }))
+                            {
+                                break;
+                            }
+                        }
+                    }
+                    catch (...)
+                    {
+                        fail(std::current_exception());
+                    }
+
+                    if (--workersLeft == 0)
+                    {
+                        built.close();
+                    }
+                });
+            }
+
+            // 3
+            Components components;
+            std::map<std::uint64_t, Components> waiting;   // Batches that finished ahead of their turn
+            std::uint64_t nextSequence = 0;
+
+            while (std::optional<Built> done = built.pop())
+            {
+                waiting.emplace(done->sequence, std::move(done->components));
+
+                for (auto it = waiting.find(nextSequence); it != waiting.end(); it = waiting.find(++nextSequence))
+                {
+                    std::move(it->second.begin(), it->second.end(), std::back_inserter(components));
+                    waiting.erase(it);
+                    inFlight.release();
+                }
+            }
+
+            // After a failure the reader may still be waiting for a batch to be appended
+            inFlight.release(4 * static_cast<std::ptrdiff_t>(threads));
+            reader.join();
+
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+
+            if (failure)
+            {
+                std::rethrow_exception(failure);
+            }
+
+            if (components.size() != expected)
+            {
+                throw std::runtime_error("corrupt newsletter: component count doesn't match header");
+            }
+
+            return components;
+        }
+
+    private:
+        static constexpr std::size_t batchBytes = 1 << 20;
+
+        // Whole records, each located by its offset in bytes
+        struct Batch
+        {
+            std::uint64_t sequence;
+            std::vector<std::byte> bytes;
+            std::vector<std::pair<std::size_t, RecordHeader>> records;
+        };
+
+        struct Built
+        {
+            std::uint64_t sequence;
+            Components components;
+        };
+
+        // Returns the number of components the stream should hold
+        static std::uint64_t readHeader(std::istream& str)
+        {
+            NewsLetterHeader header;
+
+            if (!str.read(reinterpret_cast<char*>(&header), sizeof(header))
+                || std::memcmp(header.magic, newsLetterMagic, sizeof(header.magic)) != 0
+                || header.version != newsLetterVersion)
+            {
+                throw std::runtime_error("not a newsletter stream");
+            }
+
+            return header.count;
+        }
+
+        // Reads records until the batch holds about batchBytes; only record headers are examined
+        static Batch readBatch(std::istream& str, std::uint64_t sequence)
+        {
+            Batch batch { sequence, {}, {} };
+            RecordHeader header;
+
+            while (batch.bytes.size() < batchBytes)
+            {
+                if (!str.read(reinterpret_cast<char*>(&header), sizeof(header)))
+                {
+                    // Only a stream that ends exactly between records has ended cleanly
+                    if (str.gcount() != 0)
+                    {
+                        throw std::runtime_error("corrupt newsletter: truncated record header");
+                    }
+
+                    break;
+                }
+
+                const std::size_t padded = (header.length + recordAlignment - 1) / recordAlignment * recordAlignment;
+                const std::size_t offset = batch.bytes.size();
+
+                batch.bytes.resize(offset + padded);
+
+                if (!str.read(reinterpret_cast<char*>(batch.bytes.data() + offset), std::streamsize(padded)))
+                {
+                    throw std::runtime_error("corrupt newsletter: truncated record");
+                }
+
+                batch.records.emplace_back(offset, header);
+            }
+
+            return batch;
+        }
+
+        // The virtual constructor, applied to every record of a batch
+        static Components construct(const Batch& batch)
+        {
+            Components components;
+            components.reserve(batch.records.size());
+
+            for (const auto& [offset, header] : batch.records)
+            {
+                const std::span<const std::byte> payload { batch.bytes.data() + offset, header.length };
+
+                switch (header.type)
+                {
+                    case ComponentType::textBlock:
+                        components.push_back(std::make_unique<TextBlock>(std::string(TextBlockView { payload }.text())));
+                        break;
+
+                    case ComponentType::graphic:
+                    {
+                        const GraphicView graphic { payload };
+                        components.push_back(std::make_unique<Graphic>(static_cast<int>(graphic.width()),
+                                                                       static_cast<int>(graphic.height())));
+                        break;
+                    }
+
+                    default:
+                        throw std::runtime_error("corrupt newsletter: unknown component type");
+                }
+            }
+
+            return components;
+        }
+};
+
+
+/**
+ * Benchmark:
+ * Writes 10^6 components to an in-memory stream, then loads them with the pipeline at increasing thread counts.
+ * With one worker, construction is sequential and only reading overlaps with it.
+*/
+int main()
+{
+    std::stringstream stream;
+    NewsLetterWriter writer { stream };
+
+    for (int i = 0; i < 1000000; ++i)
+    {
+        if (i % 2 == 0)
+        {
+            writer.addTextBlock("paragraph " + std::to_string(i) + std::string(100, '.'));
+        }
+        else
+        {
+            writer.addGraphic(static_cast<std::uint32_t>(i % 640), static_cast<std::uint32_t>(i % 480), {});
+        }
+    }
+
+    writer.finish();
+
+    const unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        stream.clear();
+        stream.seekg(0);
+
+        auto begin = std::chrono::steady_clock::now();
+        ParallelNewsLetterLoader::Components components = ParallelNewsLetterLoader::load(stream, threads);
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << std::setw(2) << threads << " threads: " << components.size() << " components in "
+                  << std::chrono::duration<double, std::milli>(end - begin).count() << " ms\n";
+    }
+
+    return 0;
+}
+
+
+/**
+ * Cloning Into an Arena:
+ * The NewsLetter copy constructor calls clone for every component, and every clone is a separate call to new, plus
+ * another for a TextBlock's text. An overload of the virtual copy constructor that takes an Arena puts the copy, and
+ * everything it owns, into memory the caller provides:
+ *
+ *     virtual NLComponent* clone(Arena& arena) const;
+ *
+ * Arena is a std::pmr::memory_resource that hands out memory by bumping a pointer through large chunks and frees it all
+ * at once when the arena is destroyed. Because TextBlock keeps its text in a std::pmr::string, the text of a clone
+ * comes from the same arena. cloneBytes() reports how much arena memory a clone will need, so the NewsLetter copy
+ * constructor can add it up for every component, reserve a single chunk of exactly that size, and then clone every
+ * component into it: one allocation per copy instead of one or two per component.
+ *
+ * Objects in an arena are destroyed explicitly (the arena only releases memory), so NewsLetter calls each component's
+ * destructor before its arena goes away.
+*/
+class Arena: public std::pmr::memory_resource
+{
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator = (const Arena&) = delete;
+
+        ~Arena() override
+        {
+            for (Chunk& chunk : chunks)
+            {
+                ::operator delete(chunk.memory, chunk.size, std::align_val_t { chunkAlignment });
+            }
+        }
+
+        // Ensures the next bytes of requests are served without another allocation
+        void reserve(std::size_t bytes)
+        {
+            if (static_cast<std::size_t>(limit - next) < bytes)
+            {
+                addChunk(bytes);
+            }
+        }
+
+        std::size_t chunkCount() const { return chunks.size(); }
+
+    private:
+        static constexpr std::size_t chunkAlignment = alignof(std::max_align_t);
+        static constexpr std::size_t minimumChunk = 64 * 1024;
+
+        struct Chunk
+        {
+            std::byte* memory;
+            std::size_t size;
+        };
+
+        std::vector<Chunk> chunks;
+        std::byte* next = nullptr;
+        std::byte* limit = nullptr;
+
+        void addChunk(std::size_t bytes)
+        {
+            const std::size_t size = std::max(bytes, chunks.empty() ? minimumChunk : chunks.back().size * 2);
+            std::byte* memory = static_cast<std::byte*>(::operator new(size, std::align_val_t { chunkAlignment }));
+
+            chunks.push_back({ memory, size });
+            next = memory;
+            limit = memory + size;
+        }
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            void* position = next;
+            std::size_t space = static_cast<std::size_t>(limit - next);
+
+            if (next == nullptr || std::align(alignment, bytes, position, space) == nullptr)
+            {
+                addChunk(bytes + alignment);
+                position = next;
+                space = static_cast<std::size_t>(limit - next);
+                std::align(alignment, bytes, position, space);
+            }
+
+            next = static_cast<std::byte*>(position) + bytes;
+
+            return position;
+        }
+
+        // Memory is only released when the arena is destroyed
+        void do_deallocate(void*, std::size_t, std::size_t) override { }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+
+class NLComponent
+{
+    public:
+        virtual ~NLComponent() = default;
+
+        // Virtual copy constructors: one on the heap, one in an arena
+        virtual NLComponent* clone() const = 0;
+        virtual NLComponent* clone(Arena& arena) const = 0;
+
+        // Arena bytes that clone(arena) will use, including alignment padding
+        virtual std::size_t cloneBytes() const = 0;
+
+        virtual std::ostream& print(std::ostream& s) const = 0;
+};
+
+
+class TextBlock: public NLComponent
+{
+    public:
+        explicit TextBlock(std::string_view text, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : text { text, memory } { }
+
+        virtual TextBlock* clone() const { return new TextBlock(text); }
+
+        virtual TextBlock* clone(Arena& arena) const
+        {
+            void* memory = arena.allocate(sizeof(TextBlock), alignof(TextBlock));
+
+            return ::new (memory) TextBlock(text, &arena);
+        }
+
+        virtual std::size_t cloneBytes() const
+        {
+            return sizeof(TextBlock) + alignof(TextBlock) + text.size() + 1 + alignof(char);
+        }
+
+        virtual std::ostream& print(std::ostream& s) const { return s << text << '\n'; }
+
+    private:
+        std::pmr::string text;
+};
+
+
+class Graphic: public NLComponent
+{
+    public:
+        Graphic(int width, int height) : width { width }, height { height } { }
+
+        virtual Graphic* clone() const { return new Graphic(*this); }
+
+        virtual Graphic* clone(Arena& arena) const
+        {
+            return ::new (arena.allocate(sizeof(Graphic), alignof(Graphic))) Graphic(*this);
+        }
+
+        virtual std::size_t cloneBytes() const { return sizeof(Graphic) + alignof(Graphic); }
+
+        virtual std::ostream& print(std::ostream& s) const { return s << "[graphic " << width << 'x' << height << "]\n"; }
+
+    private:
+        int width;
+        int height;
+};
+
+
+// A newsletter whose components all live in its own arena
+class NewsLetter
+{
+    public:
+        NewsLetter() : arena { std::make_unique<Arena>() } { }
+
+        NewsLetter(const NewsLetter& rhs)
+            : arena { std::make_unique<Arena>() }
+        {
+            std::size_t bytes = 0;
+
+            for (const NLComponent* component : rhs.components)
+            {
+                bytes += component->cloneBytes();
+            }
+
+            arena->reserve(bytes);
+            components.reserve(rhs.components.size());
+
+            for (const NLComponent* component : rhs.components)
+            {
+                components.push_back(component->clone(*arena));
+            }
+        }
+
+        NewsLetter& operator = (const NewsLetter& rhs) = delete;
+
+        ~NewsLetter()
+        {
+            for (NLComponent* component : components)
+            {
+                component->~NLComponent();
+            }
+        }
+
+        void add(const NLComponent& component) { components.push_back(component.clone(*arena)); }
+
+        std::size_t size() const { return components.size(); }
+        std::size_t allocations() const { return arena->chunkCount(); }
+
+    private:
+        std::unique_ptr<Arena> arena;   // Declared first, so it is destroyed after the components
+        std::vector<NLComponent*> components;
+};
+
+
+/**
+ * Benchmark:
+ * Copies newsletters of 10^5 and 10^6 components, once with the heap clone() into a std::list, as the original
+ * NewsLetter copy constructor does, and once with the arena copy constructor.
+*/
+int main()
+{
+    for (int count : { 100000, 1000000 })
+    {
+        NewsLetter original;
+        std::list<NLComponent*> heapOriginal;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (i % 2 == 0)
+            {
+                TextBlock text { "paragraph " + std::to_string(i) + std::string(40, '.') };
+                original.add(text);
+                heapOriginal.push_back(text.clone());
+            }
+            else
+            {
+                Graphic graphic { i % 640, i % 480 };
+                original.add(graphic);
+                heapOriginal.push_back(graphic.clone());
+            }
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        std::list<NLComponent*> heapCopy;
+
+        for (const NLComponent* component : heapOriginal)
+        {
+            heapCopy.push_back(component->clone());
+        }
+
+        auto middle = std::chrono::steady_clock::now();
+        NewsLetter arenaCopy { original };
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << count << " components: heap clone " << std::chrono::duration<double, std::milli>(middle - begin).count()
+                  << " ms, arena copy " << std::chrono::duration<double, std::milli>(end - middle).count() << " ms ("
+                  << arenaCopy.allocations() << " allocation)\n";
+
+        for (NLComponent* component : heapOriginal) { delete component; }
+        for (NLComponent* component : heapCopy) { delete component; }
+    }
+
+    return 0;
+}
+
+
+/**
+ * Copy-on-Write Components:
+ * Both copy constructors above still make a new object for every component, though most copies of a newsletter never
+ * change most of its components. With the reference counting of Item 29, a copy can share the original's components
+ * and clone one only when it is about to be changed.
+ *
+ * NLComponent derives from RCObject, and RCPtr does the counting. The components are kept in fixed-size Chunks of
+ * chunkSize RCPtr<NLComponent>, each chunk itself reference counted, and NewsLetter holds a single RCPtr to its
+ * Chunks, the vector of chunk pointers. Copying a NewsLetter copies that one pointer, whatever its size. Changes go
+ * through modify, which unshares only the path to the component: the vector of chunk pointers (one pointer per
+ * chunkSize components), the one chunk that holds the component, and the component itself. An edit to a copy of a
+ * million-component newsletter therefore copies about four thousand chunk pointers, one chunk and one component,
+ * and memory grows with the number of edits rather than with the size of the newsletter times the number of copies.
+ *
+ * modify passes the component to a function instead of returning a reference to it. No reference into a component
+ * escapes, so unlike String::operator[] in Item 29 there is nothing to mark unshareable, and later copies stay O(1).
+ * Like RCObject in Item 29, the counts are not atomic: a NewsLetter and its copies belong to one thread.
+*/
+class RCObject
+{
+    public:
+        void addReference() { ++refCount; }
+        void removeReference() { if (--refCount == 0) delete this; }
+
+        bool isShared() const { return refCount > 1; }
+
+    protected:
+        RCObject() = default;
+        RCObject(const RCObject&) : refCount { 0 } { }
+        RCObject& operator = (const RCObject&) { return *this; }
+        virtual ~RCObject() = default;
+
+    private:
+        std::size_t refCount = 0;
+};
+
+
+template<class T>
+class RCPtr
+{
+    public:
+        RCPtr(T* realPtr = nullptr) : pointee { realPtr } { init(); }
+        RCPtr(const RCPtr& rhs) : pointee { rhs.pointee } { init(); }
+
+        RCPtr& operator = (const RCPtr& rhs)
+        {
+            if (pointee != rhs.pointee)
+            {
+                T* old = pointee;
+                pointee = rhs.pointee;
+                init();
+
+                if (old)
+                {
+                    old->removeReference();
+                }
+            }
+
+            return *this;
+        }
+
+        ~RCPtr() { if (pointee) pointee->removeReference(); }
+
+        T* operator -> () const { return pointee; }
+        T& operator * () const { return *pointee; }
+
+        // Gives this pointer its own copy of the pointee if anyone else refers to it
+        void unshare()
+        {
+            if (pointee->isShared())
+            {
+                T* copy = pointee->clone();
+                copy->addReference();
+                pointee->removeReference();
+                pointee = copy;
+            }
+        }
+
+    private:
+        T* pointee;
+
+        void init() { if (pointee) pointee->addReference(); }
+};
+
+
+class NLComponent: public RCObject
+{
+    public:
+        virtual NLComponent* clone() const = 0;
+        virtual std::ostream& print(std::ostream& s) const = 0;
+};
+
+
+class TextBlock: public NLComponent
+{
+    public:
+        explicit TextBlock(std::string text) : text { std::move(text) } { }
+
+        virtual TextBlock* clone() const { return new TextBlock(*this); }
+        virtual std::ostream& print(std::ostream& s) const { return s << text << '\n'; }
+
+        void setText(std::string newText) { text = std::move(newText); }
+
+    private:
+        std::string text;
+};
+
+
+class Graphic: public NLComponent
+{
+    public:
+        Graphic(int width, int height) : width { width }, height { height } { }
+
+        virtual Graphic* clone() const { return new Graphic(*this); }
+        virtual std::ostream& print(std::ostream& s) const { return s << "[graphic " << width << 'x' << height << "]\n"; }
+
+        void resize(int newWidth, int newHeight) { width = newWidth; height = newHeight; }
+
+    private:
+        int width;
+        int height;
+};
+
+
+class NewsLetter
+{
+    public:
+        static constexpr std::size_t chunkSize = 256;
+
+        NewsLetter() : chunks { new Chunks } { }
+
+        // The compiler-generated copy constructor and assignment copy one RCPtr and the size
+
+        void add(std::unique_ptr<NLComponent> component)
+        {
+            // Owned by an RCPtr before anything can throw, so a failed push_back deletes it
+            RCPtr<NLComponent> item { component.release() };
+
+            chunks.unshare();
+
+            if (count % chunkSize == 0)
+            {
+                chunks->items.push_back(new Chunk);
+            }
+
+            RCPtr<Chunk>& last = chunks->items.back();
+            last.unshare();
+            last->items.push_back(item);
+            ++count;
+        }
+
+        std::size_t size() const { return count; }
+
+        template<class Component, class Function>
+        void modify(std::size_t index, Function change)
+        {
+            if (index >= count)
+            {
+                throw std::out_of_range("NewsLetter::modify: no such component");
+            }
+
+            chunks.unshare();
+
+            RCPtr<Chunk>& chunk = chunks->items[index / chunkSize];
+            chunk.unshare();
+
+            RCPtr<NLComponent>& item = chunk->items[index % chunkSize];
+            item.unshare();
+            change(dynamic_cast<Component&>(*item));
+        }
+
+        std::ostream& print(std::ostream& s) const
+        {
+            for (const RCPtr<Chunk>& chunk : chunks->items)
+            {
+                for (const RCPtr<NLComponent>& item : chunk->items)
+                {
+                    item->print(s);
+                }
+            }
+
+            return s;
+        }
+
+    private:
+        struct Chunk: public RCObject
+        {
+            std::vector<RCPtr<NLComponent>> items;
+
+            Chunk() { items.reserve(chunkSize); }
+            Chunk(const Chunk& rhs) : RCObject(rhs) { items.reserve(chunkSize); items = rhs.items; }
+
+            Chunk* clone() const { return new Chunk(*this); }
+        };
+
+        struct Chunks: public RCObject
+        {
+            std::vector<RCPtr<Chunk>> items;
+
+            Chunks* clone() const { return new Chunks(*this); }
+        };
+
+        RCPtr<Chunks> chunks;
+        std::size_t count = 0;
+};
+
+
+/**
+ * Benchmark:
+ * Copies a newsletter of 10^6 components ten times, changing ten components in each copy, once by cloning every
+ * component and once with copy-on-write. Most of the copy-on-write time is the first modify copying the vector of
+ * chunk pointers; a copy that is only read costs nothing beyond one increment.
+*/
+int main()
+{
+    constexpr int count = 1000000;
+    constexpr int copies = 10;
+    constexpr int edits = 10;
+
+    NewsLetter original;
+    std::vector<std::unique_ptr<NLComponent>> deepOriginal;
+
+    for (int i = 0; i < count; ++i)
+    {
+        original.add(std::make_unique<TextBlock>("paragraph " + std::to_string(i)));
+        deepOriginal.push_back(std::make_unique<TextBlock>("paragraph " + std::to_string(i)));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int copy = 0; copy < copies; ++copy)
+    {
+        std::vector<std::unique_ptr<NLComponent>> deepCopy;
+        deepCopy.reserve(deepOriginal.size());
+
+        for (const auto& component : deepOriginal)
+        {
+            deepCopy.emplace_back(component->clone());
+        }
+
+        for (int edit = 0; edit < edits; ++edit)
+        {
+            static_cast<TextBlock&>(*deepCopy[edit * 1000]).setText("edited");
+        }
+    }
+
+    auto middle = std::chrono::steady_clock::now();
+
+    for (int copy = 0; copy < copies; ++copy)
+    {
+        NewsLetter cowCopy { original };
+
+        for (int edit = 0; edit < edits; ++edit)
+        {
+            cowCopy.modify<TextBlock>(edit * 1000, [](TextBlock& text) { text.setText("edited"); });
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "deep clone:    " << std::chrono::duration<double, std::milli>(middle - begin).count() / copies
+              << " ms per copy\n"
+              << "copy-on-write: " << std::chrono::duration<double, std::milli>(end - middle).count() / copies
+              << " ms per copy\n";
+
+    return 0;
+}
+
+
+/**
+ * Printing Into a Buffer:
+ * operator<< prints each component through std::ostream, and as Item 23 shows, formatting with iostreams is the slow
+ * path: every insertion checks the stream's state, consults its locale and goes through the stream buffer. A
+ * newsletter with a million components pays that a few million times.
+ *
+ * A second print virtual writes into an OutputBuffer instead: one large contiguous buffer that components append to
+ * directly, with numbers formatted by std::to_chars. NewsLetter::render has every component fill the buffer and then
+ * hands the whole thing to the operating system with a single write, looping only if the write is partial. The
+ * ostream operator stays for code that prints to streams.
+*/
+class OutputBuffer
+{
+    public:
+        explicit OutputBuffer(std::size_t capacity = 1 << 20) { data.reserve(capacity); }
+
+        OutputBuffer& append(std::string_view text)
+        {
+            data.insert(data.end(), text.begin(), text.end());
+            return *this;
+        }
+
+        OutputBuffer& append(char c)
+        {
+            data.push_back(c);
+            return *this;
+        }
+
+        OutputBuffer& append(int value)
+        {
+            char digits[std::numeric_limits<int>::digits10 + 2];
+            auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+            return append(std::string_view(digits, end - digits));
+        }
+
+        // Writes the whole buffer to a file descriptor and empties it
+        void flush(int fd)
+        {
+            const char* next = data.data();
+            std::size_t remaining = data.size();
+
+            while (remaining > 0)
+            {
+                ssize_t written = ::write(fd, next, remaining);
+
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    throw std::system_error(errno, std::generic_category(), "write");
+                }
+
+                next += written;
+                remaining -= static_cast<std::size_t>(written);
+            }
+
+            data.clear();
+        }
+
+        std::size_t size() const { return data.size(); }
+
+    private:
+        std::vector<char> data;
+};
+
+
+class NLComponent
+{
+    public:
+        virtual ~NLComponent() = default;
+
+        virtual NLComponent* clone() const = 0;
+
+        virtual std::ostream& print(std::ostream& s) const = 0;
+        virtual OutputBuffer& print(OutputBuffer& buffer) const = 0;
+};
+
+
+class TextBlock: public NLComponent
+{
+    public:
+        explicit TextBlock(std::string text) : text { std::move(text) } { }
+
+        virtual TextBlock* clone() const { return new TextBlock(*this); }
+
+        virtual std::ostream& print(std::ostream& s) const { return s << text << '\n'; }
+        virtual OutputBuffer& print(OutputBuffer& buffer) const { return buffer.append(text).append('\n'); }
+
+    private:
+        std::string text;
+};
+
+
+class Graphic: public NLComponent
+{
+    public:
+        Graphic(int width, int height) : width { width }, height { height } { }
+
+        virtual Graphic* clone() const { return new Graphic(*this); }
+
+        virtual std::ostream& print(std::ostream& s) const { return s << "[graphic " << width << 'x' << height << "]\n"; }
+
+        virtual OutputBuffer& print(OutputBuffer& buffer) const
+        {
+            return buffer.append("[graphic ").append(width).append('x').append(height).append("]\n");
+        }
+
+    private:
+        int width;
+        int height;
+};
+
+
+inline std::ostream& operator << (std::ostream& s, const NLComponent& c)
+{
+    return c.print(s);
+}
+
+
+class NewsLetter
+{
+    public:
+        void add(std::unique_ptr<NLComponent> component) { components.push_back(std::move(component)); }
+
+        std::ostream& print(std::ostream& s) const
+        {
+            for (const auto& component : components)
+            {
+                s << *component;
+            }
+
+            return s;
+        }
+
+        void render(int fd) const
+        {
+            // A guess at the average component size, so the buffer rarely has to grow
+            OutputBuffer buffer { components.size() * 24 };
+
+            for (const auto& component : components)
+            {
+                component->print(buffer);
+            }
+
+            buffer.flush(fd);
+        }
+
+    private:
+        std::vector<std::unique_ptr<NLComponent>> components;
+};
+
+
+/**
+ * Benchmark:
+ * Prints a newsletter of 10^6 components to /dev/null, once through std::ostream and once through render.
+*/
+int main()
+{
+    NewsLetter newsLetter;
+
+    for (int i = 0; i < 1000000; ++i)
+    {
+        if (i % 2 == 0)
+        {
+            newsLetter.add(std::make_unique<TextBlock>("paragraph " + std::to_string(i)));
+        }
+        else
+        {
+            newsLetter.add(std::make_unique<Graphic>(i % 640, i % 480));
+        }
+    }
+
+    std::ofstream stream("/dev/null");
+    int fd = ::open("/dev/null", O_WRONLY);
+
+    auto begin = std::chrono::steady_clock::now();
+    newsLetter.print(stream);
+    stream.flush();
+    auto middle = std::chrono::steady_clock::now();
+    newsLetter.render(fd);
+    auto end = std::chrono::steady_clock::now();
+
+    ::close(fd);
+
+    std::cout << "std::ostream: " << std::chrono::duration<double, std::milli>(middle - begin).count() << " ms\n"
+              << "render:       " << std::chrono::duration<double, std::milli>(end - middle).count() << " ms\n";
+
+    return 0;
+}
@@ -1,4 +1,25 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <semaphore>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 /**
  * Limiting the number of objects of a class.
 */
@@ -163,6 +184,7 @@ class Counted
     public:
         class TooManyObjects{}; // for throwing exceptions
         static size_t objectCount() { return numObjects; }
+        static size_t objectLimit() { return maxObjects; }
 
     protected:
         Counted();
@@ -237,4 +259,1091 @@ class Printer: private Counted<Printer>
  * Clients of the counting class template must provide initialization for the maximum number of allowable instances,
  * such as setting the maximum number of Printer objects to 10.
 */
-const size_t Counted<Printer>::maxObjects = 10;
\ No newline at end of file
+const size_t Counted<Printer>::maxObjects = 10;
+
+
+/**
+ * A Concurrent Printer:
+ * With a single Printer every submitter goes through one object, and if submitJob prints the job before returning,
+ * every thread that prints waits for every other. A Printer can instead accept jobs from any number of threads into a
+ * queue and print them on a pool of devices, as many as the limit on Printer objects would allow.
+ *
+ * Each priority has its own bounded MPMCQueue, a lock-free ring of cells whose sequence numbers tell producers and
+ * consumers whether a cell is free or full. Two semaphores per queue turn it into a blocking queue only when it must
+ * block: freeSlots makes submitJob wait when the queue is full (backpressure), and jobsQueued lets idle devices sleep
+ * instead of spinning. When neither is at zero, submitting and taking a job touch only atomics.
+ *
+ * A device takes up to batchSize jobs each time it wakes, always from the highest priority queue that has any, prints
+ * them, and then completes them. submitJob returns a future that becomes ready when the job has been printed. A
+ * steady stream of high priority jobs starves low priority ones, which is what priorities are for.
+*/
+enum class Priority { high, normal, low };
+
+struct PrintJob
+{
+    std::string document;
+    Priority priority = Priority::normal;
+};
+
+
+template<class T>
+class MPMCQueue
+{
+    public:
+        explicit MPMCQueue(std::size_t capacity)
+            : cells { std::make_unique<Cell[]>(std::bit_ceil(capacity)) }, mask { std::bit_ceil(capacity) - 1 }
+        {
+            for (std::size_t i = 0; i <= mask; ++i)
+            {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator = (const MPMCQueue&) = delete;
+
+        ~MPMCQueue()
+        {
+            T value;
+
+            while (tryPop(value)) { }
+        }
+
+        // Moves from value only if it succeeds; fails if the queue is full
+        bool tryPush(T&& value)
+        {
+            std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+            Cell* cell;
+
+            while (true)
+            {
+                cell = &cells[position & mask];
+                std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+                if (difference == 0)
+                {
+                    if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            ::new (cell->storage) T(std::move(value));
+            cell->sequence.store(position + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Fails if the queue is empty, or if the next job's producer has not finished writing it
+        bool tryPop(T& value)
+        {
+            std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+            Cell* cell;
+
+            while (true)
+            {
+                cell = &cells[position & mask];
+                std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+                if (difference == 0)
+                {
+                    if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = dequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            T* stored = std::launder(reinterpret_cast<T*>(cell->storage));
+            value = std::move(*stored);
+            stored->~T();
+            cell->sequence.store(position + mask + 1, std::memory_order_release);
+
+            return true;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<std::size_t> sequence;
+            alignas(T) std::byte storage[sizeof(T)];
+        };
+
+        std::unique_ptr<Cell[]> cells;
+        const std::size_t mask;
+
+        // Producers and consumers each get their own cache line
+        alignas(64) std::atomic<std::size_t> enqueuePosition { 0 };
+        alignas(64) std::atomic<std::size_t> dequeuePosition { 0 };
+};
+
+
+class Printer
+{
+    public:
+        static constexpr std::size_t queueCapacity = 4096;
+        static constexpr std::size_t batchSize = 32;
+
+        Printer(const Printer&) = delete;
+        Printer& operator = (const Printer&) = delete;
+
+        ~Printer()
+        {
+            stopping.store(true, std::memory_order_relaxed);
+
+            // One device may take all of these at once, but each device releases one more as it exits
+            jobsQueued.release(static_cast<std::ptrdiff_t>(devices.size()));
+
+            for (Device& device : devices)
+            {
+                device.thread.join();
+            }
+        }
+
+        // Blocks while the job's queue is full
+        std::future<void> submitJob(PrintJob job)
+        {
+            Queue& queue = queues[static_cast<std::size_t>(job.priority)];
+            Task task { std::move(job), std::promise<void> {} };
+            std::future<void> done = task.done.get_future();
+
+            queue.freeSlots.acquire();
+
+            // A slot is free, but its cell may still be being emptied by the device that took it
+            while (!queue.tasks.tryPush(std::move(task)))
+            {
+                std::this_thread::yield();
+            }
+
+            jobsQueued.release();
+
+            return done;
+        }
+
+        std::size_t bytesPrinted() const
+        {
+            std::size_t bytes = 0;
+
+            for (const Device& device : devices)
+            {
+                bytes += device.bytesPrinted.load(std::memory_order_relaxed);
+            }
+
+            return bytes;
+        }
+
+        friend Printer& thePrinter();
+
+    private:
+        struct Task
+        {
+            PrintJob job;
+            std::promise<void> done;
+        };
+
+        struct Queue
+        {
+            MPMCQueue<Task> tasks { queueCapacity };
+            std::counting_semaphore<> freeSlots { static_cast<std::ptrdiff_t>(queueCapacity) };
+        };
+
+        struct alignas(64) Device
+        {
+            std::thread thread;
+            std::atomic<std::size_t> bytesPrinted { 0 };
+        };
+
+        std::array<Queue, 3> queues;
+        std::counting_semaphore<> jobsQueued { 0 };
+        std::atomic<bool> stopping { false };
+        std::vector<Device> devices;
+
+        // The limit Counted<Printer> puts on Printer objects
+        static std::size_t maxDevices() { return Counted<Printer>::objectLimit(); }
+
+        explicit Printer(std::size_t deviceCount = std::numeric_limits<std::size_t>::max())
+            : devices(std::min(deviceCount, maxDevices()))
+        {
+            for (Device& device : devices)
+            {
+                device.thread = std::thread([this, &device] { run(device); });
+            }
+        }
+
+        void run(Device& device)
+        {
+            std::vector<Task> batch;
+            batch.reserve(batchSize);
+
+            while (true)
+            {
+                jobsQueued.acquire();
+
+                // Every count stands for a queued job, except those released for shutdown
+                std::size_t jobs = 1;
+
+                while (jobs < batchSize && jobsQueued.try_acquire())
+                {
+                    ++jobs;
+                }
+
+                const bool drained = !take(batch, jobs);
+
+                print(device, batch);
+
+                if (drained)
+                {
+                    // This device may have swallowed the wakeups meant for others, so pass one on
+                    jobsQueued.release();
+
+                    return;
+                }
+            }
+        }
+
+        // Takes jobs from the queues, highest priority first; false once stopping and they are all empty, in which
+        // case the batch may still hold the jobs found before that
+        bool take(std::vector<Task>& batch, std::size_t jobs)
+        {
+            Task task;
+
+            while (batch.size() < jobs)
+            {
+                bool found = false;
+
+                for (Queue& queue : queues)
+                {
+                    if (queue.tasks.tryPop(task))
+                    {
+                        queue.freeSlots.release();
+                        batch.push_back(std::move(task));
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found)
+                {
+                    if (stopping.load(std::memory_order_relaxed))
+                    {
+                        return false;
+                    }
+
+                    std::this_thread::yield();
+                }
+            }
+
+            return true;
+        }
+
+        void print(Device& device, std::vector<Task>& batch)
+        {
+            std::size_t bytes = 0;
+
+            for (const Task& task : batch)
+            {
+                bytes += task.job.document.size();
+            }
+
+            device.bytesPrinted.fetch_add(bytes, std::memory_order_relaxed);
+
+            for (Task& task : batch)
+            {
+                task.done.set_value();
+            }
+
+            batch.clear();
+        }
+};
+
+Printer& thePrinter()
+{
+    static Printer p;
+
+    return p;
+}
+
+
+/**
+ * Benchmark:
+ * Submits 2^18 jobs from 1 to 64 producer threads and waits for all of them to be printed.
+*/
+int main()
+{
+    constexpr std::size_t jobs = 1 << 18;
+
+    for (std::size_t producers = 1; producers <= 64; producers *= 2)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+
+        for (std::size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([producers, p]
+            {
+                std::vector<std::future<void>> pending;
+                pending.reserve(jobs / producers);
+
+                for (std::size_t i = 0; i < jobs / producers; ++i)
+                {
+                    auto priority = i % 8 == 0 ? Priority::high : Priority::normal;
+                    pending.push_back(thePrinter().submitJob({ "page " + std::to_string(p), priority }));
+                }
+
+                for (std::future<void>& done : pending)
+                {
+                    done.get();
+                }
+            });
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - begin;
+        std::cout << producers << " producers: " << jobs / seconds.count() / 1e6 << " million jobs/s\n";
+    }
+
+    return 0;
+}
+
+
+/**
+ * Counting Across Threads:
+ * Counted's numObjects is a plain size_t, so two threads constructing objects at once race on it, and the limit can be
+ * exceeded or the count corrupted. Making it atomic fixes the race but puts every construction and destruction in
+ * every thread on the same cache line. Counted therefore takes a mode:
+ *
+ * CountMode::exact keeps one atomic count and reserves a slot with a compare-and-swap that only succeeds below the
+ * limit, so the count never passes maxObjects, not even for a moment. Construction is a load and one uncontended
+ * CAS, and a class at its limit fails without writing to the shared line at all.
+ *
+ * CountMode::approximate gives each thread one of shardCount counters, each on its own cache line, and objectCount()
+ * adds them up. An object destroyed on another thread decrements that thread's shard, so single shards can go
+ * negative while the sum stays right. A thread only adds up the shards every checkInterval constructions, so the
+ * limit can be exceeded by up to checkInterval objects per thread. This mode is for classes whose count is a
+ * statistic or a soft cap.
+*/
+enum class CountMode { exact, approximate };
+
+template<class BeingCounted, CountMode mode = CountMode::exact>
+class Counted
+{
+    public:
+        class TooManyObjects{}; // for throwing exceptions
+
+        static std::size_t objectCount()
+        {
+            if constexpr (mode == CountMode::exact)
+            {
+                return numObjects.load(std::memory_order_relaxed);
+            }
+            else
+            {
+                std::ptrdiff_t sum = 0;
+
+                for (const Shard& shard : shards)
+                {
+                    sum += shard.count.load(std::memory_order_relaxed);
+                }
+
+                return sum < 0 ? 0 : static_cast<std::size_t>(sum);
+            }
+        }
+
+    protected:
+        Counted() { init(); }
+        Counted(const Counted&) { init(); }
+
+        ~Counted()
+        {
+            if constexpr (mode == CountMode::exact)
+            {
+                numObjects.fetch_sub(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                shards[shardIndex()].count.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        static constexpr std::size_t shardCount = 64;
+        static constexpr std::size_t checkInterval = 64;
+
+        struct alignas(64) Shard
+        {
+            std::atomic<std::ptrdiff_t> count { 0 };
+        };
+
+        static inline std::atomic<std::size_t> numObjects { 0 };
+        static inline Shard shards[mode == CountMode::approximate ? shardCount : 1];
+        static inline std::atomic<std::size_t> nextShard { 0 };
+        static const std::size_t maxObjects;
+
+        static std::size_t shardIndex()
+        {
+            thread_local const std::size_t index = nextShard.fetch_add(1, std::memory_order_relaxed) % shardCount;
+
+            return index;
+        }
+
+        // To avoid ctor code duplication
+        void init()
+        {
+            if constexpr (mode == CountMode::exact)
+            {
+                std::size_t count = numObjects.load(std::memory_order_relaxed);
+
+                do
+                {
+                    if (count >= maxObjects)
+                    {
+                        throw TooManyObjects();
+                    }
+                }
+                while (!numObjects.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+            }
+            else
+            {
+                thread_local std::size_t sinceCheck = 0;
+
+                if (++sinceCheck == checkInterval)
+                {
+                    sinceCheck = 0;
+
+                    if (objectCount() >= maxObjects)
+                    {
+                        throw TooManyObjects();
+                    }
+                }
+
+                shards[shardIndex()].count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+};
+
+
+// Usage
+class Session: private Counted<Session, CountMode::exact>
+{
+    public:
+        using Counted<Session, CountMode::exact>::objectCount;
+        using Counted<Session, CountMode::exact>::TooManyObjects;
+};
+
+class Message: private Counted<Message, CountMode::approximate>
+{
+    public:
+        using Counted<Message, CountMode::approximate>::objectCount;
+};
+
+template<>
+const std::size_t Counted<Session, CountMode::exact>::maxObjects = 1000000;
+
+template<>
+const std::size_t Counted<Message, CountMode::approximate>::maxObjects = 1000000;
+
+
+/**
+ * Benchmark:
+ * Each thread constructs and destroys ten million objects, keeping up to 64 alive at a time, in exact and in
+ * approximate mode, and reports the total rate. On a machine with many cores the exact count, one cache line shared
+ * by every thread, stops scaling after a few threads, while the sharded count keeps scaling until there are more
+ * threads than shards.
+*/
+template<class Counter>
+double millionsPerSecond(std::size_t threadCount)
+{
+    constexpr std::size_t objects = 10000000;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([]
+        {
+            std::vector<std::optional<Counter>> live(64);
+
+            for (std::size_t i = 0; i < objects; ++i)
+            {
+                live[i % live.size()].emplace();
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - begin;
+
+    return objects * threadCount / seconds.count() / 1e6;
+}
+
+int main()
+{
+    for (std::size_t threads = 1; threads <= 16; threads *= 2)
+    {
+        std::cout << threads << " threads: exact " << millionsPerSecond<Session>(threads) << " M/s, approximate "
+                  << millionsPerSecond<Message>(threads) << " M/s\n";
+    }
+
+    return 0;
+}
+
+
+/**
+ * Recycling Limited Objects:
+ * makeFSA and makePrinter build a new object on every call, and the object is destroyed when its owner lets it go. For
+ * a class that is limited to a few objects because each one is expensive, such as an FSA with a large transition table
+ * or a Printer holding a device connection, most of the cost of a short use is construction.
+ *
+ * An InstancePool keeps up to maxObjects instances. acquire hands out an idle one if there is one, builds a new one
+ * while fewer than maxObjects exist, and otherwise waits for one to come back or, with WhenExhausted::failFast, throws
+ * TooManyObjects. The handle is a unique_ptr whose deleter returns the instance to the pool after calling its reset()
+ * hook, which puts it back in the state a new object would have. An instance whose reset() throws is destroyed
+ * rather than reused. The pseudo-constructors keep their names and return handles, so callers don't change; the pool
+ * must outlive its handles, which a function-local static pool does. The copy constructors stay out of reach, since a
+ * copy would be an instance the pool doesn't count: the copying pseudo-constructors acquire an instance and copy the
+ * state into it instead.
+*/
+enum class WhenExhausted { wait, failFast };
+
+template<class T>
+class InstancePool
+{
+    public:
+        class TooManyObjects{};
+
+        class Recycler
+        {
+            public:
+                explicit Recycler(InstancePool* pool = nullptr) : pool { pool } { }
+
+                void operator () (T* object) const { pool->recycle(object); }
+
+            private:
+                InstancePool* pool;
+        };
+
+        using Handle = std::unique_ptr<T, Recycler>;
+
+        InstancePool(std::size_t maxObjects, std::function<std::unique_ptr<T>()> make)
+            : maxObjects { maxObjects }, make { std::move(make) } { }
+
+        InstancePool(const InstancePool&) = delete;
+        InstancePool& operator = (const InstancePool&) = delete;
+
+        Handle acquire(WhenExhausted whenExhausted = WhenExhausted::wait)
+        {
+            std::unique_lock lock { mutex };
+
+            while (true)
+            {
+                if (!idle.empty())
+                {
+                    std::unique_ptr<T> object = std::move(idle.back());
+                    idle.pop_back();
+
+                    return Handle(object.release(), Recycler(this));
+                }
+
+                if (created < maxObjects)
+                {
+                    ++created;
+                    lock.unlock();
+
+                    try
+                    {
+                        return Handle(make().release(), Recycler(this));
+                    }
+                    catch (...)
+                    {
+                        forget();
+                        throw;
+                    }
+                }
+
+                if (whenExhausted == WhenExhausted::failFast)
+                {
+                    throw TooManyObjects();
+                }
+
+                available.wait(lock);
+            }
+        }
+
+        std::size_t objectCount() const
+        {
+            std::lock_guard lock { mutex };
+
+            return created;
+        }
+
+    private:
+        mutable std::mutex mutex;
+        std::condition_variable available;
+        std::vector<std::unique_ptr<T>> idle;
+        std::size_t created = 0;
+        const std::size_t maxObjects;
+        std::function<std::unique_ptr<T>()> make;
+
+        void recycle(T* released)
+        {
+            std::unique_ptr<T> object { released };
+
+            try
+            {
+                object->reset();
+            }
+            catch (...)
+            {
+                object.reset();
+                forget();
+                return;
+            }
+
+            {
+                std::lock_guard lock { mutex };
+                idle.push_back(std::move(object));
+            }
+
+            available.notify_one();
+        }
+
+        // An object was destroyed or never built, so another may be
+        void forget()
+        {
+            {
+                std::lock_guard lock { mutex };
+                --created;
+            }
+
+            available.notify_one();
+        }
+};
+
+
+class FSA
+{
+    public:
+        using Handle = InstancePool<FSA>::Handle;
+
+        // Copies would be FSAs outside the pool, and past its limit
+        FSA(const FSA&) = delete;
+        FSA& operator = (const FSA&) = delete;
+        ~FSA() = default;
+
+        // Pseudo-constructors
+        static Handle makeFSA(WhenExhausted whenExhausted = WhenExhausted::wait) { return pool().acquire(whenExhausted); }
+
+        static Handle makeFSA(const FSA& rhs, WhenExhausted whenExhausted = WhenExhausted::wait)
+        {
+            Handle fsa = makeFSA(whenExhausted);
+            fsa->state = rhs.state;
+
+            return fsa;
+        }
+
+        // Recycling hook
+        void reset() { state = 0; }
+
+        int step(unsigned char input) { return state = transitions[state * 256 + input]; }
+
+    private:
+        static constexpr int states = 1024;
+        static constexpr std::size_t maxObjects = 8;
+
+        std::vector<int> transitions;
+        int state = 0;
+
+        // Building the transition table is what makes an FSA expensive
+        FSA() : transitions(states * 256)
+        {
+            for (int from = 0; from < states; ++from)
+            {
+                for (int input = 0; input < 256; ++input)
+                {
+                    transitions[from * 256 + input] = (from * 31 + input * 17) % states;
+                }
+            }
+        }
+
+        static InstancePool<FSA>& pool()
+        {
+            static InstancePool<FSA> instances { maxObjects, [] { return std::unique_ptr<FSA>(new FSA); } };
+
+            return instances;
+        }
+};
+
+
+class Printer
+{
+    public:
+        using Handle = InstancePool<Printer>::Handle;
+
+        // Copies would be printers outside the pool, and past its limit
+        Printer(const Printer&) = delete;
+        Printer& operator = (const Printer&) = delete;
+        ~Printer() = default;
+
+        // Pseudo-constructors; at most maxObjects printers exist, as with Counted<Printer>
+        static Handle makePrinter(WhenExhausted whenExhausted = WhenExhausted::wait)
+        {
+            return pool().acquire(whenExhausted);
+        }
+
+        static Handle makePrinter(const Printer& rhs, WhenExhausted whenExhausted = WhenExhausted::wait)
+        {
+            Handle printer = makePrinter(whenExhausted);
+            printer->bytesPrinted = rhs.bytesPrinted;
+
+            return printer;
+        }
+
+        void submitJob(const PrintJob& job) { bytesPrinted += job.document.size(); }
+
+        // Recycling hook
+        void reset() { bytesPrinted = 0; }
+
+    private:
+        static constexpr std::size_t maxObjects = 10;
+
+        std::size_t bytesPrinted = 0;
+
+        Printer() = default;
+
+        static InstancePool<Printer>& pool()
+        {
+            static InstancePool<Printer> instances { maxObjects, [] { return std::unique_ptr<Printer>(new Printer); } };
+
+            return instances;
+        }
+};
+
+
+/**
+ * Benchmark:
+ * 10^4 short uses of an FSA, each running it over 64 bytes, once building a new FSA for every use and once through
+ * makeFSA. Reports the mean and 99th percentile latency of a use.
+*/
+class FreshFSA
+{
+    public:
+        FreshFSA() : transitions(1024 * 256)
+        {
+            for (int from = 0; from < 1024; ++from)
+            {
+                for (int input = 0; input < 256; ++input)
+                {
+                    transitions[from * 256 + input] = (from * 31 + input * 17) % 1024;
+                }
+            }
+        }
+
+        int step(unsigned char input) { return state = transitions[state * 256 + input]; }
+
+    private:
+        std::vector<int> transitions;
+        int state = 0;
+};
+
+template<class Use>
+void report(const char* name, Use use)
+{
+    constexpr int uses = 10000;
+
+    std::vector<double> latencies;
+    latencies.reserve(uses);
+
+    for (int i = 0; i < uses; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        use();
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / uses;
+
+    std::cout << name << ": mean " << mean << " us, p99 " << latencies[uses * 99 / 100] << " us\n";
+}
+
+int main()
+{
+    volatile int sink = 0;
+
+    report("new FSA ", [&]
+    {
+        FreshFSA fsa;
+
+        for (int i = 0; i < 64; ++i)
+        {
+            sink = fsa.step(static_cast<unsigned char>(i));
+        }
+    });
+
+    report("makeFSA ", [&]
+    {
+        FSA::Handle fsa = FSA::makeFSA();
+
+        for (int i = 0; i < 64; ++i)
+        {
+            sink = fsa->step(static_cast<unsigned char>(i));
+        }
+    });
+
+    return 0;
+}
+
+
+/**
+ * Controlling Singleton Lifetimes:
+ * thePrinter's function-local static is constructed the first time any thread calls it, which the compiler makes
+ * thread-safe with a guard variable that is checked on every call, and it is destroyed in the reverse order of
+ * construction after main returns, along with every other static. There is no way to construct it at a chosen point,
+ * and no way to destroy it while the threads and objects it depends on are still around.
+ *
+ * Singleton<T> gives that control. initialize() constructs the instance eagerly, so startup can create singletons in a
+ * fixed order; instance() constructs it lazily if that hasn't happened. After a thread's first call, instance() goes
+ * through a pointer cached in a thread_local, stamped with the generation it was cached in; checking it costs one
+ * relaxed load and a predictable branch, with no read-modify-write and no guard.
+ * Each construction registers the instance with Singletons, and Singletons::shutdown() destroys them in reverse order
+ * of construction: a singleton whose constructor uses another is constructed after it, so it is destroyed first.
+ *
+ * shutdown() then moves to a new generation, so every thread's cached pointer goes stale and a later instance() builds
+ * a fresh instance rather than using the deleted one. shutdown() must still not run while other threads are using
+ * singletons, since nothing stops them from holding on to a reference.
+*/
+class Singletons
+{
+    public:
+        static void shutdown()
+        {
+            std::lock_guard lock { mutex() };
+
+            while (!destroyers().empty())
+            {
+                void (*destroy)() = destroyers().back();
+                destroyers().pop_back();
+                destroy();
+            }
+
+            generation.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    private:
+        template<class T>
+        friend class Singleton;
+
+        // Starts at 1, so that a thread's cache, which starts at 0, is stale until it is filled
+        static inline std::atomic<std::uint64_t> generation { 1 };
+
+        // Recursive, because a singleton's constructor may ask for another singleton
+        static std::recursive_mutex& mutex()
+        {
+            static std::recursive_mutex m;
+
+            return m;
+        }
+
+        static std::vector<void (*)()>& destroyers()
+        {
+            static std::vector<void (*)()> d;
+
+            return d;
+        }
+};
+
+
+template<class T>
+class Singleton
+{
+    public:
+        static T& instance()
+        {
+            thread_local Cached cached;
+            const std::uint64_t current = Singletons::generation.load(std::memory_order_relaxed);
+
+            if (cached.generation != current) [[unlikely]]
+            {
+                cached = { initialize(), current };
+            }
+
+            return *cached.object;
+        }
+
+        // Constructs the instance if it doesn't exist yet
+        static T* initialize()
+        {
+            T* existing = object.load(std::memory_order_acquire);
+
+            if (existing != nullptr)
+            {
+                return existing;
+            }
+
+            std::lock_guard lock { Singletons::mutex() };
+            existing = object.load(std::memory_order_relaxed);
+
+            if (existing == nullptr)
+            {
+                existing = new T;
+                Singletons::destroyers().push_back(&destroy);
+                object.store(existing, std::memory_order_release);
+            }
+
+            return existing;
+        }
+
+    private:
+        struct Cached
+        {
+            T* object = nullptr;
+            std::uint64_t generation = 0;
+        };
+
+        static inline std::atomic<T*> object { nullptr };
+
+        static void destroy()
+        {
+            delete object.exchange(nullptr, std::memory_order_acq_rel);
+        }
+};
+
+
+// Usage
+class Logger
+{
+    public:
+        void log(std::string_view message) { lines += !message.empty(); }
+
+    private:
+        friend class Singleton<Logger>;
+
+        std::size_t lines = 0;
+
+        Logger() = default;
+};
+
+class Printer
+{
+    public:
+        void submitJob(const PrintJob& job) { Singleton<Logger>::instance().log(job.document); }
+
+    private:
+        friend class Singleton<Printer>;
+
+        // Uses the Logger, so the Logger is constructed first and destroyed last
+        Printer() { Singleton<Logger>::instance().log("printer ready"); }
+};
+
+Printer& thePrinter()
+{
+    return Singleton<Printer>::instance();
+}
+
+
+/**
+ * Benchmark:
+ * 1 to 16 threads each make 10^7 calls to thePrinter and to a version built on a function-local static, whose
+ * constructor, like Printer's, is not constexpr, so that the compiler has to guard it. Both are kept out of line so
+ * that the compiler cannot hoist the access out of the loop. The time reported is the wall time over each thread's
+ * calls, so it is what a call costs a thread while the others are making theirs. On x86-64 the two cost about the same,
+ * since the guard check there is also one load and a predictable branch; on ARM the guard needs a load-acquire on
+ * every call and the generation check, a relaxed load, does not. What Singleton adds is control over when instances
+ * are built and torn down, at no cost per call.
+*/
+class MagicPrinter
+{
+    public:
+        MagicPrinter() { Singleton<Logger>::instance().log("printer ready"); }
+};
+
+[[gnu::noinline]] MagicPrinter& theMagicPrinter()
+{
+    static MagicPrinter p;
+
+    return p;
+}
+
+[[gnu::noinline]] Printer& theCachedPrinter()
+{
+    return Singleton<Printer>::instance();
+}
+
+// Makes the compiler assume the pointer is used, without a store to memory
+inline void escape(const void* pointer)
+{
+    asm volatile("" : : "r"(pointer));
+}
+
+template<class Access>
+double nanosecondsPerCall(std::size_t threadCount, Access access)
+{
+    constexpr std::size_t calls = 10000000;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([access]
+        {
+            for (std::size_t i = 0; i < calls; ++i)
+            {
+                escape(&access());
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+
+    return elapsed.count() / calls;
+}
+
+int main()
+{
+    Singleton<Logger>::initialize();
+    Singleton<Printer>::initialize();
+
+    for (std::size_t threads = 1; threads <= 16; threads *= 2)
+    {
+        std::cout << threads << " threads: magic static " << nanosecondsPerCall(threads, theMagicPrinter)
+                  << " ns, Singleton " << nanosecondsPerCall(threads, theCachedPrinter) << " ns per call\n";
+    }
+
+    Singletons::shutdown();
+
+    return 0;
+}
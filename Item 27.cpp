@@ -1,4 +1,16 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
 #include <list>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 /**
  * Requiring or prohibiting heap-based objects.
 */
@@ -206,4 +218,533 @@ bool HeapTracked::isOnHeap() const
 /**
  * Application Limitation:
  * The HeapTracked class cannot be used with built-in types like int and char as they cannot inherit from classes.
-*/
\ No newline at end of file
+*/
+
+
+/**
+ * Constant-Time Lookups:
+ * HeapTracked keeps its addresses in a list, so operator delete and isOnHeap both search it, and with a million live
+ * objects each of them looks at up to a million entries. The list is also unprotected, so objects can only be created
+ * and destroyed on one thread.
+ *
+ * Keeping the addresses in a hash set makes both operations O(1) on average. AddressSet is an open-addressing table
+ * split into shards, each shard an array of atomic slots probed linearly from the address's hash. Insertion claims a
+ * free slot with a compare-and-swap, erasure turns the address's slot into a tombstone, and lookups walk the probe
+ * sequence until they find the address or a slot that was never used, so none of them takes a lock. An address is
+ * only inserted while it is not already present, because operator new never returns memory that is still in use.
+ *
+ * Insertions reuse tombstones, but a lookup has to walk past them, and a miss, which is what isOnHeap sees for every
+ * stack object, only stops at an empty slot. Left alone, churn would turn a shard's empty slots into tombstones until
+ * every miss scanned the whole shard. So each shard counts its tombstones, and the erasure that brings them to a
+ * quarter of its slots compacts the shard in place: it copies out the live addresses, empties every slot and inserts
+ * them again. While that runs, the shard's sequence number is odd; lookups that overlap it retry, and insertions and
+ * erasures wait for it, while compaction in turn waits for those already under way. A compaction costs time linear in
+ * the shard's size, but it takes a quarter of the shard's slots in erasures to bring about, so under churn a miss
+ * stays a few probes and every operation stays O(1) amortized. If the copy can't be allocated, the shard is compacted
+ * by a later erasure instead.
+ *
+ * The table doesn't grow, so its capacity is fixed: maxTracked addresses at a load factor of at most one half, 2^16
+ * unless the program calls HeapTracked::setMaxTracked before it creates any tracked objects. operator new throws
+ * bad_alloc rather than filling a shard. A shard allocates its slots on its first insertion, so a program that tracks a
+ * handful of objects pays for a handful of shards, 16 KiB each by default, rather than for the whole table. Each shard
+ * also counts its live objects and their bytes, which trackedObjects and trackedBytes add up; the sized operator
+ * delete supplies the size of the object being freed.
+*/
+class AddressSet
+{
+    public:
+        static constexpr std::size_t shardCount = 64;
+
+        explicit AddressSet(std::size_t maxTracked)
+        {
+            setCapacity(maxTracked);
+        }
+
+        AddressSet(const AddressSet&) = delete;
+        AddressSet& operator = (const AddressSet&) = delete;
+
+        ~AddressSet()
+        {
+            for (Shard& shard : shards)
+            {
+                delete shard.table.load(std::memory_order_relaxed);
+            }
+        }
+
+        // Only sizes the shards that haven't allocated their slots yet
+        void setCapacity(std::size_t maxTracked)
+        {
+            slotsPerShard.store(std::bit_ceil(std::max<std::size_t>(2 * maxTracked / shardCount, 16)),
+                                std::memory_order_relaxed);
+        }
+
+        // False if the address's shard is full
+        bool insert(const void* address, std::size_t size)
+        {
+            auto key = reinterpret_cast<std::uintptr_t>(address);
+            auto [shard, hash] = locate(key);
+            Table& table = tableOf(*shard);
+            enter(*shard);
+
+            for (std::size_t probes = 0, slot = table.first(hash); probes <= table.mask; ++probes,
+                 slot = (slot + 1) & table.mask)
+            {
+                std::uintptr_t current = table.slots[slot].load(std::memory_order_relaxed);
+
+                while (current == empty || current == tombstone)
+                {
+                    // On success current keeps the value that was replaced
+                    if (table.slots[slot].compare_exchange_weak(current, key, std::memory_order_release,
+                                                                std::memory_order_relaxed))
+                    {
+                        if (current == tombstone)
+                        {
+                            table.tombstones.fetch_sub(1, std::memory_order_relaxed);
+                        }
+
+                        shard->objects.fetch_add(1, std::memory_order_relaxed);
+                        shard->bytes.fetch_add(size, std::memory_order_relaxed);
+                        leave(*shard);
+                        return true;
+                    }
+                }
+            }
+
+            leave(*shard);
+            return false;
+        }
+
+        // False if the address isn't in the set
+        bool erase(const void* address, std::size_t size)
+        {
+            auto key = reinterpret_cast<std::uintptr_t>(address);
+            auto [shard, hash] = locate(key);
+            Table* table = shard->table.load(std::memory_order_acquire);
+
+            if (table == nullptr)
+            {
+                return false;
+            }
+
+            enter(*shard);
+            std::atomic<std::uintptr_t>* slot = table->find(key, hash);
+
+            if (slot == nullptr)
+            {
+                leave(*shard);
+                return false;
+            }
+
+            slot->store(tombstone, std::memory_order_release);
+            shard->objects.fetch_sub(1, std::memory_order_relaxed);
+            shard->bytes.fetch_sub(size, std::memory_order_relaxed);
+
+            const bool crowded = table->tombstones.fetch_add(1, std::memory_order_relaxed) + 1 >= (table->mask + 1) / 4;
+            leave(*shard);
+
+            if (crowded)
+            {
+                compact(*shard, *table);
+            }
+
+            return true;
+        }
+
+        bool contains(const void* address) const
+        {
+            auto key = reinterpret_cast<std::uintptr_t>(address);
+            auto [shard, hash] = locate(key);
+            const Table* table = shard->table.load(std::memory_order_acquire);
+
+            if (table == nullptr)
+            {
+                return false;
+            }
+
+            while (true)
+            {
+                std::size_t sequence = shard->sequence.load(std::memory_order_acquire);
+
+                if (sequence % 2 != 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                const bool found = table->find(key, hash) != nullptr;
+
+                // A compaction that moved slots under the search has changed the sequence number
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (shard->sequence.load(std::memory_order_relaxed) == sequence)
+                {
+                    return found;
+                }
+            }
+        }
+
+        std::size_t objects() const { return sum(&Shard::objects); }
+        std::size_t bytes() const { return sum(&Shard::bytes); }
+
+    private:
+        // Addresses are aligned, so neither can be a tracked address
+        static constexpr std::uintptr_t empty = 0;
+        static constexpr std::uintptr_t tombstone = 1;
+
+        struct Table
+        {
+            std::unique_ptr<std::atomic<std::uintptr_t>[]> slots;
+            const std::size_t mask;
+            std::atomic<std::size_t> tombstones { 0 };
+
+            explicit Table(std::size_t size)
+                : slots { std::make_unique<std::atomic<std::uintptr_t>[]>(size) }, mask { size - 1 }
+            {
+            }
+
+            std::size_t first(std::uint64_t hash) const { return static_cast<std::size_t>(hash >> 26) & mask; }
+
+            // The address's slot, or null if it isn't in the table
+            std::atomic<std::uintptr_t>* find(std::uintptr_t key, std::uint64_t hash) const
+            {
+                for (std::size_t probes = 0, slot = first(hash); probes <= mask; ++probes, slot = (slot + 1) & mask)
+                {
+                    std::uintptr_t current = slots[slot].load(std::memory_order_acquire);
+
+                    if (current == key)
+                    {
+                        return &slots[slot];
+                    }
+
+                    if (current == empty)
+                    {
+                        return nullptr;
+                    }
+                }
+
+                return nullptr;
+            }
+        };
+
+        struct alignas(64) Shard
+        {
+            std::atomic<Table*> table { nullptr };
+            std::atomic<std::size_t> objects { 0 };
+            std::atomic<std::size_t> bytes { 0 };
+
+            // Odd while the shard is being compacted
+            std::atomic<std::size_t> sequence { 0 };
+
+            // Insertions and erasures under way
+            std::atomic<std::size_t> writers { 0 };
+        };
+
+        std::atomic<std::size_t> slotsPerShard;
+        Shard shards[shardCount];
+
+        // Fibonacci hashing: the top bits pick the shard, the next ones the first slot to probe
+        static std::uint64_t hashOf(std::uintptr_t key)
+        {
+            return static_cast<std::uint64_t>(key >> 4) * 0x9E3779B97F4A7C15ull;
+        }
+
+        std::pair<Shard*, std::uint64_t> locate(std::uintptr_t key) const
+        {
+            std::uint64_t hash = hashOf(key);
+
+            return { const_cast<Shard*>(&shards[hash >> 58]), hash };
+        }
+
+        // Waits out a compaction of the shard, then keeps the next one from starting until leave()
+        static void enter(Shard& shard)
+        {
+            while (true)
+            {
+                if (shard.sequence.load(std::memory_order_acquire) % 2 == 0)
+                {
+                    shard.writers.fetch_add(1, std::memory_order_seq_cst);
+
+                    if (shard.sequence.load(std::memory_order_seq_cst) % 2 == 0)
+                    {
+                        return;
+                    }
+
+                    shard.writers.fetch_sub(1, std::memory_order_relaxed);
+                }
+
+                std::this_thread::yield();
+            }
+        }
+
+        static void leave(Shard& shard)
+        {
+            shard.writers.fetch_sub(1, std::memory_order_release);
+        }
+
+        // Turns the shard's tombstones back into empty slots by inserting its live addresses again
+        static void compact(Shard& shard, Table& table)
+        {
+            std::unique_ptr<std::uintptr_t[]> live { new (std::nothrow) std::uintptr_t[table.mask + 1] };
+            std::size_t sequence = shard.sequence.load(std::memory_order_relaxed);
+
+            // Called from operator delete, so it mustn't throw; another erasure will try again
+            if (live == nullptr || sequence % 2 != 0 ||
+                !shard.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_seq_cst))
+            {
+                return;
+            }
+
+            // Lookups that read a slot written below must see the odd sequence number
+            std::atomic_thread_fence(std::memory_order_release);
+
+            while (shard.writers.load(std::memory_order_seq_cst) != 0)
+            {
+                std::this_thread::yield();
+            }
+
+            std::size_t count = 0;
+
+            for (std::size_t slot = 0; slot <= table.mask; ++slot)
+            {
+                std::uintptr_t current = table.slots[slot].load(std::memory_order_relaxed);
+
+                if (current != empty && current != tombstone)
+                {
+                    live[count++] = current;
+                }
+
+                table.slots[slot].store(empty, std::memory_order_relaxed);
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::size_t slot = table.first(hashOf(live[i]));
+
+                while (table.slots[slot].load(std::memory_order_relaxed) != empty)
+                {
+                    slot = (slot + 1) & table.mask;
+                }
+
+                table.slots[slot].store(live[i], std::memory_order_relaxed);
+            }
+
+            table.tombstones.store(0, std::memory_order_relaxed);
+            shard.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        // Allocates the shard's slots on its first insertion; if two threads race to do so, one table is kept
+        Table& tableOf(Shard& shard)
+        {
+            Table* current = shard.table.load(std::memory_order_acquire);
+
+            if (current != nullptr)
+            {
+                return *current;
+            }
+
+            auto fresh = std::make_unique<Table>(slotsPerShard.load(std::memory_order_relaxed));
+
+            if (shard.table.compare_exchange_strong(current, fresh.get(), std::memory_order_acq_rel,
+                                                    std::memory_order_acquire))
+            {
+                return *fresh.release();
+            }
+
+            return *current;
+        }
+
+        std::size_t sum(std::atomic<std::size_t> Shard::* counter) const
+        {
+            std::size_t total = 0;
+
+            for (const Shard& shard : shards)
+            {
+                total += (shard.*counter).load(std::memory_order_relaxed);
+            }
+
+            return total;
+        }
+};
+
+
+class HeapTracked
+{
+    public:
+        // Exception class
+        class MissingAddress{};
+
+        static constexpr std::size_t defaultMaxTracked = 1 << 16;
+
+        virtual ~HeapTracked() = 0;
+
+        static void* operator new(std::size_t size);
+        static void operator delete(void* ptr, std::size_t size);
+
+        bool isOnHeap() const;
+
+        static std::size_t trackedObjects() { return addresses().objects(); }
+        static std::size_t trackedBytes() { return addresses().bytes(); }
+
+        // Call before creating any tracked objects; shards that already hold addresses keep their size
+        static void setMaxTracked(std::size_t maxTracked) { addresses().setCapacity(maxTracked); }
+
+    private:
+        static AddressSet& addresses()
+        {
+            static AddressSet set { defaultMaxTracked };
+
+            return set;
+        }
+};
+
+HeapTracked::~HeapTracked() {}
+
+void* HeapTracked::operator new(std::size_t size)
+{
+    void* memPtr = ::operator new(size);
+
+    if (!addresses().insert(memPtr, size))
+    {
+        ::operator delete(memPtr);
+        throw std::bad_alloc();
+    }
+
+    return memPtr;
+}
+
+void HeapTracked::operator delete(void* ptr, std::size_t size)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    if (!addresses().erase(ptr, size))
+    {
+        throw MissingAddress();
+    }
+
+    ::operator delete(ptr);
+}
+
+bool HeapTracked::isOnHeap() const
+{
+    return addresses().contains(dynamic_cast<const void*>(this));
+}
+
+
+/**
+ * Benchmark:
+ * Four threads each create 250,000 tracked objects, so 10^6 are live at once, then ask every one of them and as many
+ * stack objects whether they are on the heap, and delete them. The list version is measured with 10^4 objects, since
+ * with 10^6 it would take hours.
+*/
+class Asset: public HeapTracked
+{
+    public:
+        explicit Asset(int id) : id { id } { }
+
+    private:
+        int id;
+};
+
+int main()
+{
+    constexpr int threadCount = 4;
+    constexpr int perThread = 250000;
+
+    HeapTracked::setMaxTracked(2 * threadCount * perThread);
+
+    std::vector<std::vector<Asset*>> assets(threadCount);
+    std::atomic<int> onHeap { 0 };
+    std::vector<std::thread> threads;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (int i = 0; i < perThread; ++i)
+            {
+                assets[t].push_back(new Asset(i));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) { thread.join(); }
+    threads.clear();
+
+    auto created = std::chrono::steady_clock::now();
+    std::size_t live = HeapTracked::trackedObjects();
+    std::size_t bytes = HeapTracked::trackedBytes();
+
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            int found = 0;
+
+            for (int i = 0; i < perThread; ++i)
+            {
+                Asset local { i };
+                found += assets[t][i]->isOnHeap() + local.isOnHeap();
+            }
+
+            onHeap += found;
+        });
+    }
+
+    for (std::thread& thread : threads) { thread.join(); }
+    threads.clear();
+
+    auto checked = std::chrono::steady_clock::now();
+
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (Asset* asset : assets[t])
+            {
+                delete asset;
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) { thread.join(); }
+
+    auto end = std::chrono::steady_clock::now();
+
+    auto nanosecondsEach = [](auto from, auto to, double operations)
+    {
+        return std::chrono::duration<double, std::nano>(to - from).count() / operations;
+    };
+
+    std::cout << live << " live objects, " << bytes << " bytes, " << onHeap << " found on the heap\n"
+              << "new:       " << nanosecondsEach(begin, created, threadCount * perThread) << " ns\n"
+              << "isOnHeap:  " << nanosecondsEach(created, checked, 2.0 * threadCount * perThread) << " ns\n"
+              << "delete:    " << nanosecondsEach(checked, end, threadCount * perThread) << " ns\n";
+
+    // The list version from above, with 10^4 objects
+    constexpr int listed = 10000;
+    std::list<const void*> list;
+    std::vector<std::unique_ptr<int>> objects;
+
+    for (int i = 0; i < listed; ++i)
+    {
+        objects.push_back(std::make_unique<int>(i));
+        list.push_front(objects.back().get());
+    }
+
+    auto listBegin = std::chrono::steady_clock::now();
+
+    for (const auto& object : objects)
+    {
+        onHeap += std::find(list.begin(), list.end(), object.get()) != list.end();
+    }
+
+    std::cout << "list isOnHeap with " << listed << " objects: "
+              << nanosecondsEach(listBegin, std::chrono::steady_clock::now(), listed) << " ns\n";
+
+    return 0;
+}